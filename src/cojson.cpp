@@ -21,6 +21,7 @@
  */
 
 #include "cojson.hpp"
+#include <string.h>
 
 namespace cojson {
 namespace details {
@@ -64,7 +65,14 @@ bool writer<const char_t*>::write(const char_t * str, ostream& out) noexcept {
 		return value::null(out);
 	bool r = true;
 	if( ! out.put(literal::quotation_mark) ) return false;
-	while( *str && (r=write(*str++,out)) );
+	while( *str && r ) {
+		/* pass plain characters in bulk */
+		const char_t* run = str;
+		while( *str && ! literal::is_control(*str) &&
+			! literal::is_escaped(*str) ) ++str;
+		if( str != run ) r = out.write(run, str - run);
+		if( r && *str ) r = write(*str++, out);
+	}
 	return r && out.put(literal::quotation_mark);
 }
 
@@ -81,6 +89,14 @@ bool reader<char_t*>::read(char_t* dst, size_t n, lexer& in) noexcept  {
 			*dst = in.hexremainder();
 			++dst; --n;
 		}
+		/* copy plain characters in bulk, leaving room for the terminator */
+		size_t len = n - 1;
+		const char_t* run;
+		if( n > 1 && (run = in.run(len)) != nullptr ) {
+			for(size_t i = 0; i < len; ++i) dst[i] = run[i];
+			in.consume(len);
+			dst += len; n -= len;
+		}
 	}
 	if( n == 0 ) {
 		*--dst = 0;
@@ -209,40 +225,238 @@ static constexpr bool is_null(char_t chr) noexcept {
 	return chr == literal_strings<char_t>::null_l()[0];
 }
 
+/* bit stack of nested arrays and objects, N levels deep */
+template<unsigned N>
 struct bstack {
 	enum sym : bool {
 		array = false,
 		object = true
 	};
-	inline bstack() : stack(0), count(0) {}
+	inline bstack() : words(), count(0) {}
 	inline bool push(sym s) noexcept {
-		if( count ==  max ) return false;
-		stack <<= 1;
-		stack |= s == object;
+		if( count ==  N ) return false;
+		unsigned_t bit = unsigned_t(1) << (count % bits);
+		if( s == object ) words[count / bits] |= bit;
+		else words[count / bits] &= ~bit;
 		++count;
 		return true;
 	}
 	inline bool pop(sym s) noexcept {
 		if ( count == 0 ) return false;
 		bool r = top() == s;
-		stack >>= 1;
 		--count;
 		return r;
 	}
 	inline bool empty() const noexcept { return count == 0; }
+	inline unsigned depth() const noexcept { return count; }
 	inline sym top() const noexcept {
-		return (stack&1) ? object : array;
+		unsigned i = count - 1;
+		return (words[i / bits] >> (i % bits)) & 1 ? object : array;
 	}
 private:
-	static constexpr uint_fast8_t max = (sizeof(uint_fast8_t)*8)-1;
-	uint_fast8_t stack;
-	uint_fast8_t count;
+	typedef unsigned unsigned_t;
+	static constexpr unsigned bits = sizeof(unsigned_t) * 8;
+	unsigned_t words[(N + bits - 1) / bits];
+	unsigned count;
 };
 
+typedef bstack<configuration::Configuration<lexer>::skip_depth> skipstack;
+
+/* position of the first quotation mark or escape in p[0..n) or n */
+template<typename C>
+static inline size_t strend(const C* p, size_t n) noexcept {
+	size_t i = 0;
+	while( i < n && p[i] != literal::quotation_mark && p[i] != literal::escape )
+		++i;
+	return i;
+}
+
+static inline size_t strend(const char* p, size_t n) noexcept {
+	const void* q = memchr(p, literal::quotation_mark, n);
+	size_t i = q ? static_cast<const char*>(q) - p : n;
+	const void* e = memchr(p, literal::escape, i);
+	return e ? static_cast<const char*>(e) - p : i;
+}
+
+size_t strscan::scan(const char_t* p, size_t n) noexcept {
+	for(size_t i = 0; i < n; ) {
+		if( escaped ) {
+			escaped = false;
+			++i;
+			continue;
+		}
+		i += strend(p + i, n - i);
+		if( i == n ) break;
+		if( p[i++] == literal::escape ) {
+			escaped = true;
+			continue;
+		}
+		instring = false;
+		return i;
+	}
+	return n;
+}
+
+/**
+ * Skips a value tracking only nesting and string/escape state,
+ * scalars are passed over up to a delimiter without validation.
+ * Characters are fed in runs, taken from the stream window
+ */
+class skipper {
+public:
+	enum state_t { going, done, failed };
+	inline skipper(bool list) noexcept : list(list) {
+		if( list ) stack.push(stack.array);
+	}
+	/** scans a run of n characters, returns number of characters consumed,
+	 *  a delimiter ending the value is not consumed						*/
+	size_t scan(const char_t* p, size_t n) noexcept {
+		for(size_t i = 0; i < n; ++i) {
+			if( str.inside() ) {
+				size_t k = i + str.scan(p + i, n - i);
+				if( str.inside() ) return n;
+				if( stack.empty() ) return finish(k);
+				i = k - 1;
+				continue;
+			}
+			char_t c = p[i];
+			if( scalar ) {
+				if( ! isdelim(c) ) continue;
+				scalar = false;
+				if( stack.empty() ) return finish(i);
+			}
+			switch( c ) {
+			case literal::begin_array:
+				if( ! stack.push(stack.array) ) return fail(i);
+				break;
+			case literal::begin_object:
+				if( ! stack.push(stack.object) ) return fail(i);
+				break;
+			case literal::end_array:
+				if( ! stack.pop(stack.array) ) return fail(i);
+				/* closing ] of a list is left unread */
+				if( stack.empty() ) return finish(list ? i : i + 1);
+				break;
+			case literal::end_object:
+				if( ! stack.pop(stack.object) ) return fail(i);
+				if( stack.empty() ) return finish(i + 1);
+				break;
+			case literal::value_separator:
+				if( stack.empty() ) return finish(i);
+				break;
+			case literal::name_separator:
+				if( stack.empty() || stack.top() != stack.object ) return fail(i);
+				break;
+			case literal::quotation_mark:
+				str.open();
+				break;
+			default:
+				if( ! isws(c) ) scalar = true;
+			}
+		}
+		return n;
+	}
+	/** ends the scan at end of stream */
+	inline bool end() noexcept {
+		if( state == going && ! str.inside() && stack.empty() && ! list ) {
+			state = done;
+		}
+		return state == done;
+	}
+	inline state_t status() const noexcept { return state; }
+private:
+	static inline bool isdelim(char_t c) noexcept {
+		return isws(c) || c == literal::value_separator ||
+			c == literal::end_array || c == literal::end_object;
+	}
+	inline size_t finish(size_t i) noexcept {
+		state = done;
+		return i;
+	}
+	inline size_t fail(size_t i) noexcept {
+		state = failed;
+		return i;
+	}
+	skipstack stack;
+	const bool list;
+	strscan str;
+	bool scalar = false;
+	state_t state = going;
+};
+
+/* skips with the skipper over stream windows, falls back to get()
+ * if the stream stops providing windows in the middle of a value */
+bool lexer::skip_window(bool list) noexcept {
+	skipper skip(list);
+	if( hold ) {
+		char_t c = hold;
+		hold = 0;
+		if( skip.scan(&c, 1) == 0 ) hold = c;
+	}
+	while( skip.status() == skipper::going ) {
+		size_t len = 0;
+		const char_t* ptr = stream.window(len);
+		if( ptr != nullptr && len != 0 ) {
+			stream.advance(skip.scan(ptr, len));
+			continue;
+		}
+		char_t c;
+		if( ! stream.get(c) ) {
+			if( c == iostate::eos_c && skip.end() ) return true;
+			break;
+		}
+		if( skip.scan(&c, 1) == 0 ) back(c);
+	}
+	if( skip.status() == skipper::done ) return true;
+	error(error_t::bad);
+	return false;
+}
+
+/* skips with the skipper, copying scanned characters to out */
+bool lexer::copy(ostream& out) noexcept {
+	skipper skip(false);
+	char_t c;
+	if( ! skipws(c) ) {
+		bad(c);
+		return false;
+	}
+	if( skip.scan(&c, 1) == 0 ) {
+		back(c);
+		error(error_t::bad);
+		return false;
+	}
+	bool ok = out.put(c);
+	while( skip.status() == skipper::going ) {
+		size_t len = 0;
+		const char_t* ptr = stream.window(len);
+		if( ptr != nullptr && len != 0 ) {
+			size_t n = skip.scan(ptr, len);
+			if( ok ) ok = out.write(ptr, n);
+			stream.advance(n);
+			continue;
+		}
+		if( ! stream.get(c) ) {
+			if( c == iostate::eos_c && skip.end() ) return true;
+			break;
+		}
+		if( skip.scan(&c, 1) == 0 ) back(c);
+		else if( ok ) ok = out.put(c);
+	}
+	if( skip.status() == skipper::done ) return true;
+	error(error_t::bad);
+	return false;
+}
 
 bool lexer::skip(bool list) noexcept {
 if( not mismatch_is_error ) {
-	bstack stack;
+	if( readable(stream) && stream.jump(hold, list) ) {
+		hold = 0;
+		return true;
+	}
+	size_t len = 0;
+	if( windows && readable(stream) && stream.window(len) != nullptr )
+		return skip_window(list);
+	skipstack stack;
 	char_t chr;
 	ctype ct;
 	if( list ) stack.push(stack.array);
@@ -251,6 +465,10 @@ if( not mismatch_is_error ) {
 			/* ignoring numbers and any number-looking garbage */
 			if( ! isvalid(skip(chr, ctype::number)) )
 				break;
+			if( stack.empty() ) {
+				back(chr);					/* delimiter after a number */
+				return true;
+			}
 			if( isws(chr) ) continue;
 		}
 		switch(chr) {
@@ -304,7 +522,7 @@ if( not mismatch_is_error ) {
 		}
 		if( stack.empty() ) return true;
 	};
-	if( chr == iostate::eos_c ) return stack.empty();
+	if( chr == iostate::eos_c && stack.empty() ) return true;
 	done:
 	if( stack.empty() ) {
 		if( list ) back(chr);		/* do not skip closing ] */
@@ -326,6 +544,22 @@ bool lexer::skip_string(bool first) noexcept {
 	}
 }
 
+const char_t* lexer::scan(size_t& n) noexcept {
+	size_t len = 0;
+	const char_t* ptr;
+	if( hold || ! readable(stream) || (ptr = stream.window(len)) == nullptr ) {
+		n = 0;
+		return nullptr;
+	}
+	if( len > n ) len = n;
+	for(n = 0; n < len; ++n) {
+		char_t chr = ptr[n];
+		if( chr == literal::quotation_mark || chr == literal::escape ||
+			literal::is_control(chr) ) break;
+	}
+	return ptr;
+}
+
 bool lexer::skip_member(bool first) noexcept {
 	char_t chr = 0;
 	return
@@ -438,6 +672,10 @@ bool lexer::member(char_t*& dst) noexcept {
 	char_t chr;
 	if( ! skipws(chr) ) { bad(chr); return false; }
 	if( chr != literal::quotation_mark ) { bad(chr); return false; }
+	if( ! name.good() ) {	/* no storage for the name */
+		error(error_t::noobject);
+		return false;
+	}
 	back(chr);
 	if( reader<char_t*>::read(name, name.size, *this) ) {
 		if( ! skipws(chr) ) { bad(chr); return false; }
@@ -518,6 +756,30 @@ bool value::null(ostream& out) noexcept {
 	return out.puts(literal::null_l());
 }
 
+const char_t* istream::window(size_t& n) noexcept {
+	n = 0;
+	return nullptr;
+}
+
+void istream::advance(size_t) noexcept {}
+
+bool istream::windowed() const noexcept {
+	return false;
+}
+
+bool istream::contiguous() const noexcept {
+	return false;
+}
+
+bool istream::jump(char_t, bool) noexcept {
+	return false;
+}
+
+bool ostream::write(const char_t* s, size_t n) noexcept {
+	while( n && put(*s++) ) --n;
+	return n == 0;
+}
+
 bool ostream::_puts(const char_t* s) noexcept {
 	while( *s && put(*s++));
 	return *s == 0;
@@ -535,6 +797,60 @@ bool object::write(ostream& out) const noexcept {
 	return r && end(out);
 }
 
+bool presence::record() noexcept {
+	entry* e = const_cast<entry*>(find(current.obj, current.type));
+	if( e == nullptr ) {
+		const size_t n = (current.size + width - 1) / width;
+		if( used == capacity || n > room - spent ) return false;
+		e = entries + used++;
+		e->obj = current.obj;
+		e->type = current.type;
+		e->at = spent;
+		e->words = n;
+		for(size_t i = 0; i < n; ++i) words[spent + i] = 0;
+		spent += n;
+	}
+	current.at = last = e - entries;
+	return true;
+}
+
+bool presence::test(const entry* e, size_t i) const noexcept {
+	return e != nullptr && i < e->words * width &&
+		(words[e->at + i / width] & (mask_t(1) << (i % width))) != 0;
+}
+
+bool presence::full(const entry* e, size_t n) const noexcept {
+	if( n == 0 ) return true;
+	if( e == nullptr || n > e->words * width ) return false;
+	const mask_t* w = words + e->at;
+	for(; n >= width; n -= width)
+		if( *w++ != ~mask_t(0) ) return false;
+	const mask_t m = (mask_t(1) << n) - 1;
+	return n == 0 || (*w & m) == m;
+}
+
+void presence::moved(const void* from, size_t n, const void* to) noexcept {
+	const char* begin = static_cast<const char*>(from);
+	for(size_t i = 0; i < used; ++i) {
+		const char* obj = static_cast<const char*>(entries[i].obj);
+		if( obj >= begin && obj < begin + n )
+			entries[i].obj = static_cast<const char*>(to) + (obj - begin);
+	}
+}
+
+const presence::entry* presence::find(const void* obj, const void* t)
+		const noexcept {
+	/* properties of one object are mostly queried in a row */
+	if( last < used && entries[last].obj == obj && entries[last].type == t )
+		return entries + last;
+	for(size_t i = used; i--; )
+		if( entries[i].obj == obj && entries[i].type == t ) {
+			last = i;
+			return entries + i;
+		}
+	return nullptr;
+}
+
 bool object::read(lexer& in, const char_t * name) const noexcept {
 	for(size_t i = 0; i < size; ++i) {
 		const member& m(nodes[i]());
@@ -21,6 +21,12 @@
  */
 
 #pragma once
+#if defined(__has_include)
+#	if __has_include(<new>)
+#		include <new>
+#		define WITH_COJSON_SCRATCH
+#	endif
+#endif
 #include <configuration.h>
 #include <cojson.ccs>
 #include <elemental.hpp>
@@ -423,6 +429,26 @@ struct literal : literal_strings<char_l> {
 private:
 	literal();
 };
+
+/**
+ * String state of a scan over raw JSON text. String contents are passed
+ * in runs up to a quotation mark or an escape, escaped characters are
+ * stepped over.
+ */
+class strscan {
+public:
+	/** enters a string, the opening quotation mark is consumed */
+	inline void open() noexcept { instring = true; }
+	/** true if the scan is inside a string */
+	inline bool inside() const noexcept { return instring; }
+	inline void reset() noexcept { instring = escaped = false; }
+	/** passes string characters in p[0..n), returns position past the
+	 *  closing quotation mark or n if the string goes on				*/
+	size_t scan(const char_t* p, size_t n) noexcept;
+private:
+	bool instring = false;
+	bool escaped = false;
+};
 /******************************************************************************/
 
 class noncopyable {
@@ -430,11 +456,12 @@ private:
 	noncopyable(const noncopyable&);
 	noncopyable& operator=(const noncopyable&);
 public:
-	noncopyable() { }
+	constexpr noncopyable() { }
 };
 
 struct value;
 struct member;
+class presence;
 
 /**
  * unnamed element
@@ -557,6 +584,34 @@ struct istream : virtual iostate {
 	 * in latter case dst holds error code (fail or eof)
 	 */
 	virtual bool get(char_t& dst) noexcept = 0;
+	/**
+	 * provides a contiguous window of characters available for reading
+	 * at the current head without advancing it.
+	 * returns pointer to the first character and places window length in n
+	 * or returns nullptr if the stream does not support windowed access
+	 */
+	virtual const char_t* window(size_t& n) noexcept;
+	/**
+	 * advances the head by n characters within the current window
+	 */
+	virtual void advance(size_t n) noexcept;
+	/**
+	 * returns true if the stream provides windows at all. Checked once,
+	 * when a lexer is attached, readers never ask for windows otherwise
+	 */
+	virtual bool windowed() const noexcept;
+	/**
+	 * returns true if all windows are successive parts of a single mutable
+	 * contiguous buffer, which readers may modify in place
+	 */
+	virtual bool contiguous() const noexcept;
+	/**
+	 * skips a value (or the remainder of a list if list is true, leaving
+	 * the closing bracket unread) without reading it character by character.
+	 * held is the last read character, pushed back by the lexer, or 0.
+	 * returns false if the stream cannot skip, nothing is consumed then
+	 */
+	virtual bool jump(char_t held, bool list) noexcept;
 };
 
 /**
@@ -569,6 +624,11 @@ struct ostream : virtual iostate {
 	 * returns true on success or false on error
 	 */
 	virtual bool put(char_t c) noexcept = 0;
+	/**
+	 * writes n characters from s to the stream.
+	 * returns true on success or false on error
+	 */
+	virtual bool write(const char_t* s, size_t n) noexcept;
 	/**
 	 * writes a zero-terminated string to the stream.
 	 * returns true on success or false on error
@@ -593,24 +653,115 @@ inline bool ostream::puts<const char_t*>(const char_t* v) noexcept {
 }
 
 
-template<typename T, size_t N, bool Static>
+/** temporary storage policy, given as temporary_is or as bool static */
+static constexpr inline config::temporary_is temporary_policy(bool s) noexcept {
+	return s ? config::temporary_is::statical : config::temporary_is::automatic;
+}
+
+static constexpr inline config::temporary_is temporary_policy(
+		config::temporary_is p) noexcept {
+	return p;
+}
+
+#ifdef WITH_COJSON_SCRATCH
+/**
+ * Thread local scratch arena of Size bytes for temporary buffers.
+ * Buffers are taken and given back in stack order, the arena is reset
+ * when the last one is given back. If the arena is exhausted, buffers
+ * come from the heap
+ */
+template<size_t Size>
+struct scratch {
+	static void* acquire(size_t n) noexcept {
+		arena& a = local();
+		n = round(n);
+		if( a.top + n > Size ) {
+			void* p = ::operator new(n, std::nothrow);
+			if( p ) ++a.leases;
+			return p;
+		}
+		++a.leases;
+		void* p = a.bytes + a.top;
+		a.top += n;
+		return p;
+	}
+	static void release(void* p, size_t n) noexcept {
+		arena& a = local();
+		unsigned char* b = static_cast<unsigned char*>(p);
+		--a.leases;
+		if( b < a.bytes || b >= a.bytes + Size ) {
+			::operator delete(p);
+			return;
+		}
+		if( b + round(n) == a.bytes + a.top ) a.top = b - a.bytes;
+		if( a.leases == 0 ) a.top = 0;
+	}
+private:
+	static constexpr size_t align = alignof(long double);
+	static constexpr size_t round(size_t n) noexcept {
+		return (n + align - 1) & ~(align - 1);
+	}
+	struct arena {
+		alignas(align) unsigned char bytes[Size];
+		size_t top;
+		size_t leases;
+	};
+	static arena& local() noexcept {
+		static thread_local arena a {};
+		return a;
+	}
+};
+
+#endif
+
+template<typename T, size_t N, config::temporary_is P>
 struct temporary_s {
+	static_assert(P != config::temporary_is::per_thread,
+		"per_thread temporaries need a hosted toolchain with <new>");
 	static constexpr size_t size = N;
 	typedef T type[N];
+	static inline constexpr bool good() noexcept { return true; }
 	inline operator type&() noexcept { return buffer; }
 	T buffer[N] = {};
 };
 
 template<typename T, size_t N>
-struct temporary_s<T, N, true> {
+struct temporary_s<T, N, config::temporary_is::statical> {
 	static constexpr size_t size = N;
 	typedef T type[N];
+	static inline constexpr bool good() noexcept { return true; }
 	inline operator type&() noexcept {
 		static T buffer[N] = {};
 		return buffer;
 	}
 };
 
+#ifdef WITH_COJSON_SCRATCH
+template<typename T, size_t N>
+struct temporary_s<T, N, config::temporary_is::per_thread> {
+	static constexpr size_t size = N;
+	typedef T type[N];
+	typedef details::scratch<config::scratch_size> arena;
+	inline temporary_s() noexcept
+	  : buffer(static_cast<T*>(arena::acquire(sizeof(type)))) {
+		if( buffer ) buffer[0] = 0;
+	}
+	temporary_s(const temporary_s&) = delete;
+	temporary_s& operator=(const temporary_s&) = delete;
+	inline ~temporary_s() noexcept {
+		if( buffer ) arena::release(buffer, sizeof(type));
+	}
+	/** false if the arena was exhausted and the heap failed too,
+	 *  the buffer must not be used then								*/
+	inline bool good() const noexcept { return buffer != nullptr; }
+	inline operator type&() noexcept {
+		return *reinterpret_cast<type*>(buffer);
+	}
+private:
+	T* buffer;
+};
+#endif
+
 
 enum class ctype : int {
 	unknown		= 0,
@@ -684,7 +835,8 @@ static inline /*constexpr*/ bool isws(char_t chr) noexcept {
  * Lexer/scanner
  */
 struct lexer : noncopyable {
-	inline lexer(istream& in) noexcept : stream(in), hold(0) {}
+	inline lexer(istream& in) noexcept
+	  : stream(in), hold(0), windows(in.windowed()), seen(nullptr) {}
 
 	static inline void char_typify(
 		void (*add)(const char * str,ctype traits)) noexcept {
@@ -748,6 +900,38 @@ struct lexer : noncopyable {
 	bool skip(bool list=false) noexcept;
 	/** skips string or remainder of such 									*/
 	bool skip_string(bool first) noexcept;
+	/** skips a value copying its text, leading whitespace excluded, to out.
+	 * returns true if the value was skipped, failures of out are left in
+	 * its error state, the remainder of the value is skipped then			*/
+	bool copy(ostream& out) noexcept;
+	/** returns a run of plain string characters (no quotes, escapes or
+	 * control characters) available in the stream window at the current
+	 * position. n limits the run on input and receives its length on output.
+	 * returns nullptr if no window is available. The run must be consumed
+	 * with consume() before the next read									*/
+	inline const char_t* run(size_t& n) noexcept {
+		if( ! windows ) {
+			n = 0;
+			return nullptr;
+		}
+		return scan(n);
+	}
+	/** true if the stream provides windows, runs are never available if not */
+	inline bool windowed() const noexcept { return windows; }
+	/** consumes n characters of a run 										*/
+	inline void consume(size_t n) noexcept {
+		stream.advance(n);
+	}
+	/** presence record class reads are tracked in, nullptr if none		*/
+	inline presence* tracking() const noexcept { return seen; }
+	/** true if the stream is a single mutable contiguous buffer			*/
+	inline bool contiguous() const noexcept { return stream.contiguous(); }
+	/** sets the presence record, returns the previous one 				*/
+	inline presence* tracking(presence* p) noexcept {
+		presence* prev = seen;
+		seen = p;
+		return prev;
+	}
 	inline void error(error_t e) noexcept { stream.error(e); }
 	inline error_t error() const noexcept {
 		/* eof is not a lexer error */
@@ -796,6 +980,8 @@ private:
 	ctype unhex(char_t& chr) noexcept;
 	ctype get(char_t& dst) noexcept;
 	bool skip_member(bool first) noexcept;
+	bool skip_window(bool list) noexcept;
+	const char_t* scan(size_t& n) noexcept;
 	bool literal(cstring) noexcept;
 	static inline constexpr bool is_valid(int ct) noexcept {
 		return cojson::details::isvalid(static_cast<ctype>(ct));
@@ -807,8 +993,11 @@ private:
 private:
 	using cfg = configuration::Configuration<lexer>;
 	istream& stream;
-	temporary_s<char_t, cfg::max_key_length, cfg::temporary_static> name;
+	temporary_s<char_t, cfg::max_key_length,
+		temporary_policy(cfg::temporary_static)> name;
 	char_t hold;
+	const bool windows;
+	presence* seen;
 };
 
 /******************************************************************************/
@@ -971,6 +1160,17 @@ bool write_number(T val, bool negative, T divider, ostream& out) noexcept {
 	return true;
 }
 
+/**
+ * Resets a value to its default in place. Specialized for types keeping
+ * storage, such as strings, which is then kept for the next read
+ */
+template<typename T>
+struct resetter {
+	static inline void reset(T& val) noexcept {
+		val = T();
+	}
+};
+
 /******************************************************************************/
 /* JSON writers																  */
 
@@ -1164,7 +1364,7 @@ struct collection {
  * JSON array
  */
 struct array : value {
-	inline array(const item* const itemlist, size_t length) noexcept
+	constexpr array(const item* const itemlist, size_t length) noexcept
 	: items(itemlist), size(length) {}
 
 	bool read(lexer& in) const noexcept {
@@ -1224,7 +1424,7 @@ private:
  * JSON empty array []
  */
 struct emptyarray : value {
-	emptyarray() {}
+	constexpr emptyarray() {}
 	inline bool read(lexer& in) const noexcept {
 		return in.skip();
 	}
@@ -1263,7 +1463,8 @@ private:
  * JSON object - a collection of members
  */
 struct object : value {
-	object(const node* list, size_t length) : nodes(list), size(length) {}
+	constexpr object(const node* list, size_t length) noexcept
+	  : nodes(list), size(length) {}
 	bool read(lexer& in) const noexcept {
 		return collection<indexer>::read(*this,void_v,in);
 	}
@@ -1286,7 +1487,7 @@ private:
  * JSON empty object {}
  */
 struct emptyobject : value {
-	emptyobject() {}
+	constexpr emptyobject() {}
 	inline bool read(lexer& in) const noexcept {
 		return in.skip();
 	}
@@ -1296,6 +1497,100 @@ struct emptyobject : value {
 };
 
 
+/**
+ * presence - properties seen while reading objects, one bit per property
+ * in the order properties are listed in the class, kept for every object
+ * read, nested objects and array items included. Objects are told apart
+ * by their address and type. Items of std::vector properties are followed
+ * when the vector reallocates while reading, other containers moving their
+ * items are not supported. An object takes one mask word per width
+ * properties of its class, recording is limited to the entries and words
+ * given, going past the limits sets overrun.
+ */
+class presence : noncopyable {
+public:
+	typedef uint32_t mask_t;
+	static constexpr size_t width = sizeof(mask_t) * 8;
+	/** first width properties of obj seen, 0 if none or obj was not read	*/
+	template<class C>
+	inline mask_t mask(const C& obj) const noexcept {
+		const entry* e = find(&obj, tag<C>());
+		return e ? words[e->at] : 0;
+	}
+	/** returns true if property i of obj was seen						*/
+	template<class C>
+	inline bool has(const C& obj, size_t i) const noexcept {
+		return test(find(&obj, tag<C>()), i);
+	}
+	/** returns true if all of the first n properties of obj were seen	*/
+	template<class C>
+	inline bool all(const C& obj, size_t n) const noexcept {
+		return full(find(&obj, tag<C>()), n);
+	}
+	/** number of objects recorded										*/
+	inline size_t count() const noexcept { return used; }
+	inline void clear() noexcept {
+		used = spent = last = 0;
+		current.at = none;
+	}
+
+	/** object being read, its record is looked up on its first property	*/
+	struct cursor {
+		const void* obj;
+		const void* type;
+		size_t size;
+		size_t at;
+	};
+	/** starts reading obj of type t with size properties,
+	 *  returns the cursor of the enclosing object						*/
+	inline cursor open(const void* obj, const void* t, size_t size) noexcept {
+		cursor outer = current;
+		current = cursor{obj, t, size, none};
+		return outer;
+	}
+	/** ends reading the current object, resumes the enclosing one		*/
+	inline void close(const cursor& outer) noexcept { current = outer; }
+	/** records property i of the object being read						*/
+	inline bool mark(size_t i) noexcept {
+		if( current.at == none && ! record() ) return false;
+		words[entries[current.at].at + i / width] |= mask_t(1) << (i % width);
+		return true;
+	}
+	/** moves records of objects in n bytes at from to the same offsets
+	 *  at to, called when a container reallocates its items			*/
+	void moved(const void* from, size_t n, const void* to) noexcept;
+	/** type identity, a distinct address for every C					*/
+	template<class C>
+	static inline const void* tag() noexcept {
+		static const char t = 0;
+		return &t;
+	}
+protected:
+	struct entry {
+		const void* obj;
+		const void* type;
+		size_t at;
+		size_t words;
+	};
+	constexpr presence(entry* list, size_t length, mask_t* pool, size_t size)
+	  noexcept : entries(list), words(pool), capacity(length), room(size),
+		used(0), spent(0), last(0), current{nullptr, nullptr, 0, none} {}
+private:
+	static constexpr size_t none = ~size_t(0);
+	bool record() noexcept;
+	bool test(const entry* e, size_t i) const noexcept;
+	bool full(const entry* e, size_t n) const noexcept;
+	const entry* find(const void* obj, const void* t) const noexcept;
+	entry* const entries;
+	mask_t* const words;
+	const size_t capacity;
+	const size_t room;
+	size_t used;
+	size_t spent;
+	mutable size_t last;
+	cursor current;
+};
+
 /**
  * property - a named property of c++ class or structure
  */
@@ -1309,6 +1604,9 @@ struct property : noncopyable {
 	virtual bool read(C& obj, lexer&) const noexcept = 0;
 	virtual bool write(const C& obj, ostream&) const noexcept = 0;
 	virtual bool has(const C&) const noexcept { return true; }
+	/** resets the member to its default in place, keeping its storage,
+	 *  returns false if the property can't, the object is replaced then	*/
+	virtual bool reset(C&) const noexcept { return false; }
 	inline bool match(const char_t* aname) const noexcept {
 		return details::match(name(),aname);
 	}
@@ -1323,9 +1621,30 @@ struct property : noncopyable {
 template<class C>
 struct clas : noncopyable {
 	typedef typename property<C>::node node;
-	clas(const node * n, size_t s) noexcept : nodes(n), size(s) { }
+	constexpr clas(const node * n, size_t s) noexcept : nodes(n), size(s) { }
 	bool read(C& obj, lexer& in) const noexcept {
-		return collection<indexer>::read(*this, obj, in);
+		presence* seen = in.tracking();
+		if( seen == nullptr )
+			return collection<indexer>::read(*this, obj, in);
+		presence::cursor outer = seen->open(&obj, presence::tag<C>(), size);
+		bool r = collection<indexer>::read(*this, obj, in);
+		seen->close(outer);
+		return r;
+	}
+	/** reads obj recording properties seen in this and nested objects	*/
+	bool read(C& obj, lexer& in, presence& seen) const noexcept {
+		seen.clear();
+		presence* outer = in.tracking(&seen);
+		bool r = read(obj, in);
+		in.tracking(outer);
+		return r;
+	}
+	/** resets all properties of obj in place, returns false if some can't,
+	 *  obj has to be replaced with C() then								*/
+	bool reset(C& obj) const noexcept {
+		bool r = true;
+		for(size_t i = 0; i < size; ++i) r = nodes[i]().reset(obj) && r;
+		return r;
 	}
 	bool write(const C& obj, ostream& out) const noexcept {
 		bool r = (size!=0) || object::dlm(true, out);
@@ -1351,6 +1670,8 @@ protected:
 		for(size_t i = 0; i < size; ++i) {
 			const property<C>& m(nodes[i]());
 			if( m.match(name) ) {
+				if( in.tracking() != nullptr && ! in.tracking()->mark(i) )
+					in.error(error_t::overrun);
 				m.read(obj, in);
 				return true;
 			}
@@ -1406,9 +1727,9 @@ struct scalar : value {
  * string value implementation
  */
 struct string : value {
-	inline string(char_t* s, size_t length) noexcept
+	constexpr string(char_t* s, size_t length) noexcept
 	  : str(s), size(length) {}
-	inline string(const char_t* s) noexcept
+	constexpr string(const char_t* s) noexcept
 	  : str(const_cast<char_t*>(s)), size(0) {}
 	bool read(lexer& in) const noexcept {
 		ctype ct;
@@ -1511,6 +1832,13 @@ struct propertyx : property<typename X::clas> {
 	bool has(const C& obj) const noexcept {
 		return X::has(obj);
 	}
+	bool reset(C& obj) const noexcept {
+		if( X::canlref && X::is() ) {
+			resetter<T>::reset(X::lref(obj));
+			return true;
+		}
+		return false;
+	}
 };
 
 /**
@@ -1519,7 +1847,7 @@ struct propertyx : property<typename X::clas> {
 template<class C>
 struct list : property<C> {
 	typedef typename property<C>::node node;
-	inline list(const node* const nodelist, size_t length) noexcept
+	constexpr list(const node* const nodelist, size_t length) noexcept
 		: nodes(nodelist), size(length) {}
 
 	bool read(C& obj, lexer& in) const noexcept {
@@ -1806,6 +2134,10 @@ inline const details::property<C>& PropertyVector() {
 			/* delegate write to array */
 			return details::array::write(*this, obj, out);
 		}
+		bool reset(C& obj) const noexcept {
+			for(auto& item : obj.*M) details::resetter<T>::reset(item);
+			return true;
+		}
 		/** read item */
 		inline bool read(C& obj, details::lexer& in, size_t i) const noexcept {
 			return
@@ -1833,6 +2165,10 @@ const details::property<C> & PropertyString() noexcept {
 		bool read(C& obj, details::lexer& in) const noexcept {
 			return details::reader<char_t*>::read(obj.*M, N, in);
 		}
+		bool reset(C& obj) const noexcept {
+			(obj.*M)[0] = 0;
+			return true;
+		}
 		bool write(const C& obj, details::ostream& out) const noexcept {
 			return obj.*M ?
 				details::writer<const char_t*>::write(obj.*M, out) :
@@ -1856,6 +2192,10 @@ inline const details::property<C>& PropertyStrings() {
 			/* delegate write to array */
 			return details::array::write(*this, obj, out);
 		}
+		bool reset(C& obj) const noexcept {
+			for(auto& str : obj.*M) str[0] = 0;
+			return true;
+		}
 		/** read item */
 		inline bool read(C& obj, details::lexer& in, size_t i) const noexcept {
 			return
@@ -1888,6 +2228,9 @@ inline const details::property<C> & PropertyObject() {
 		bool write(const C& obj, details::ostream& out) const noexcept {
 			return S().write(obj.*V, out);
 		}
+		bool reset(C& obj) const noexcept {
+			return S().reset(obj.*V);
+		}
 	} l;
 	return l;
 }
@@ -1906,6 +2249,11 @@ inline const details::property<C> & PropertyArrayOfObjects() {
 		bool write(const C& obj, details::ostream& out) const noexcept {
 			return details::array::write(*this, obj, out);
 		}
+		bool reset(C& obj) const noexcept {
+			bool r = true;
+			for(auto& item : obj.*V) r = S().reset(item) && r;
+			return r;
+		}
 		/** read item */
 		inline bool read(C& obj, details::lexer& in, size_t i) const noexcept {
 			S().read((obj.*V)[i], in);
@@ -1932,7 +2280,7 @@ inline const details::property<C> & PropertyList() noexcept {
 	static constexpr node list[size ? size : 1] { L ... } ;
 	static const struct local : details::list<C> {
 		cstring name() const noexcept { return id(); }
-		inline local(const node* list, size_t size) noexcept : list<C>::list(list, size) {}
+		constexpr local(const node* list, size_t size) noexcept : list<C>::list(list, size) {}
 	} l(size ? list : nullptr,size);
 	return l;
 }
@@ -2595,6 +2943,26 @@ inline bool Read(T& value, details::istream& in) noexcept {
 	return Read(value, lex);
 }
 
+/**
+ * Presence record of up to N objects of up to P properties each, filled by
+ * clas::read(obj, in, seen). Objects need no clearing before a read, only
+ * properties not seen need a reset.
+ * Usage:
+ *   Presence<4> seen;
+ *   Config::structure().read(config, in, seen);
+ *   if( ! seen.has(config.wan, 2) ) config.wan.expires = 0;
+ */
+template<size_t N = 8, size_t P = details::presence::width>
+class Presence : public details::presence {
+public:
+	constexpr Presence() noexcept
+	  : details::presence(list, N, bits, M), list(), bits() {}
+private:
+	static constexpr size_t M = N * ((P + width - 1) / width);
+	entry list[N];
+	mask_t bits[M];
+};
+
 
 namespace details {
 /****************************************************************************
@@ -2640,10 +3008,24 @@ public:
 			error(error_t::eof);
 			return false;
 		}
-		++pos;
 		val = ptr[pos++];
 		return true;
 	}
+	/* window is available only for sized arrays */
+	const char_t* window(size_t& n) noexcept {
+		n = pos < size() ? size() - pos : 0;
+		return n ? ptr + pos : nullptr;
+	}
+	void advance(size_t n) noexcept {
+		pos += n;
+	}
+	bool windowed() const noexcept {
+		return size() != 0;
+	}
+	/* sized arrays are mutable, zero terminated may be constant */
+	bool contiguous() const noexcept {
+		return size() != 0;
+	}
 	bool put(char_t val) noexcept {
 		if( pos >= size() ) {
 			error(error_t::eof);
@@ -2742,5 +3124,103 @@ private:
 	size_t	size;
 	volatile char_t* buffer;
 };
+
+/**
+ * Input stream over a chain of memory segments, such as packet buffers,
+ * read in sequence without reassembling them into a contiguous buffer.
+ * Segments are obtained one by one with the method next
+ */
+class segmented : public details::istream {
+public:
+	inline segmented() noexcept : curr(nullptr), size(0), pos(0), total(0) {}
+	bool get(char_t& val) noexcept {
+		using namespace details;
+		while( pos >= size ) {
+			if( ! fetch() ) {
+				val = iostate::eos_c;
+				istream::error(error_t::eof);
+				return false;
+			}
+		}
+		val = curr[pos++];
+		return true;
+	}
+	/* window spans the remainder of the current segment */
+	const char_t* window(size_t& n) noexcept {
+		while( pos >= size && fetch() );
+		n = size - pos;
+		return n ? curr + pos : nullptr;
+	}
+	void advance(size_t n) noexcept {
+		pos += n;
+	}
+	bool windowed() const noexcept {
+		return true;
+	}
+	/** returns total number of characters read */
+	inline size_t count() const noexcept { return total - size + pos; }
+protected:
+	/** provides next segment, returns false if no more segments */
+	virtual bool next(const char_t*& data, size_t& length) noexcept = 0;
+	inline void restart() noexcept {
+		curr = nullptr;
+		size = pos = total = 0;
+		clear();
+	}
+private:
+	inline bool fetch() noexcept {
+		if( ! next(curr, size) ) {
+			pos = size = 0;
+			return false;
+		}
+		total += size;
+		pos = 0;
+		return true;
+	}
+	const char_t* curr;
+	size_t size;
+	size_t pos;
+	size_t total;
+};
+
+/**
+ * A memory segment given by pointer and length
+ */
+struct segment {
+	const char_t* data;
+	size_t length;
+};
+
+/**
+ * Input stream over a list of memory segments
+ */
+class segments : public segmented {
+public:
+	inline segments(const segment* list, size_t count) noexcept
+	  : items(list), length(count), index(0) {}
+	template<size_t N>
+	inline segments(const segment (&list)[N]) noexcept : segments(list, N) {}
+	inline void set(const segment* list, size_t count) noexcept {
+		items = list;
+		length = count;
+		reset();
+	}
+	inline void reset() noexcept {
+		index = 0;
+		restart();
+	}
+protected:
+	bool next(const char_t*& data, size_t& n) noexcept {
+		if( index >= length ) return false;
+		data = items[index].data;
+		n = items[index].length;
+		++index;
+		return true;
+	}
+private:
+	const segment* items;
+	size_t length;
+	size_t index;
+};
 }
 } /* namespace cojson */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_chunked.hpp - HTTP/1.1 chunked transfer encoding output stream
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <cojson.hpp>
+
+namespace cojson {
+namespace wrapper {
+
+/**
+ * Collects output in a staging block of N characters and emits it as
+ * HTTP/1.1 chunks (rfc7230#section-4.1) when the block fills up,
+ * on flush() and on finish().
+ * The staging block reserves room for the chunk-size line and the trailing
+ * CRLF, so each framed chunk is handed off as one contiguous array,
+ * without copying. The hand-off function returns false on failure
+ * Usage:
+ *   chunked<512> out(send, &socket);
+ *   Object::structure().write(obj, out) && out.finish();
+ */
+template<size_t N>
+class chunked : public details::ostream {
+	static_assert(N != 0, "Staging block must not be empty");
+	static constexpr size_t digits = 2 * sizeof(size_t);
+	static constexpr size_t head = digits + 2;	/* chunk-size CRLF		*/
+	static constexpr size_t tail = 2;			/* CRLF after chunk data */
+public:
+	typedef bool (*handoff)(const char_t* chunk, size_t size, void* context);
+
+	inline chunked(handoff func, void* context = nullptr) noexcept
+	  : deliver(func), context(context), pos(head), total(0), done(false) {}
+
+	bool put(char_t c) noexcept {
+		if( pos == head + N && ! flush() ) return false;
+		block[pos++] = c;
+		return true;
+	}
+
+	bool write(const char_t* s, size_t n) noexcept {
+		while( n ) {
+			if( pos == head + N && ! flush() ) return false;
+			size_t len = head + N - pos;
+			if( len > n ) len = n;
+			for(size_t i = 0; i < len; ++i) block[pos + i] = s[i];
+			pos += len;
+			s += len;
+			n -= len;
+		}
+		return true;
+	}
+
+	/** emits staged characters as a chunk, if any */
+	bool flush() noexcept {
+		using namespace details;
+		size_t len = pos - head;
+		if( len == 0 ) return true;
+		size_t start = head - 2;
+		block[start] = '\r';
+		block[start + 1] = '\n';
+		do block[--start] = ashex(static_cast<char_t>(len & 0xF));
+		while( len >>= 4 );
+		block[pos++] = '\r';
+		block[pos++] = '\n';
+		total += pos - head - tail;
+		bool r = handoff_(block + start, pos - start);
+		pos = head;
+		return r;
+	}
+
+	/** emits staged characters and the last chunk, terminating the body */
+	bool finish() noexcept {
+		static constexpr char_t last[] = { '0', '\r', '\n', '\r', '\n' };
+		if( done ) return true;
+		done = true;
+		return flush() && handoff_(last, sizeof(last)/sizeof(last[0]));
+	}
+
+	/** returns number of body characters emitted so far */
+	inline size_t count() const noexcept { return total; }
+private:
+	inline bool handoff_(const char_t* data, size_t size) noexcept {
+		if( deliver(data, size, context) ) return true;
+		ostream::error(details::error_t::eof);
+		return false;
+	}
+	handoff const deliver;
+	void* const context;
+	size_t pos;
+	size_t total;
+	bool done;
+	char_t block[head + N + tail];
+};
+
+}
+}
@@ -0,0 +1,409 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_filters.hpp - composable output stream filters
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <cojson.hpp>
+
+namespace cojson {
+namespace wrapper {
+
+/**
+ * Forwards each character and each bulk write to N output streams
+ * Usage:
+ *   tee<2> out(socket, log);
+ *   Object::structure().write(obj, out);
+ */
+template<size_t N>
+class tee : public details::ostream {
+public:
+	template<class ... S>
+	inline tee(S& ... s) noexcept : sinks { &s ... } {
+		static_assert(sizeof...(S) == N, "Number of sinks must match N");
+	}
+	bool put(char_t c) noexcept {
+		bool r = true;
+		for(size_t i = 0; i < N; ++i)
+			r = sinks[i]->put(c) && r;
+		return r || fail();
+	}
+	bool write(const char_t* s, size_t n) noexcept {
+		bool r = true;
+		for(size_t i = 0; i < N; ++i)
+			r = sinks[i]->write(s, n) && r;
+		return r || fail();
+	}
+private:
+	/* collects errors from sinks, writing continues to good sinks */
+	bool fail() noexcept {
+		for(size_t i = 0; i < N; ++i)
+			ostream::error(sinks[i]->error());
+		return false;
+	}
+	details::ostream* const sinks[N];
+};
+
+namespace hash {
+/**
+ * CRC-32 (IEEE 802.3), computed with a 16-entry table
+ */
+class crc32 {
+public:
+	typedef uint32_t type;
+	inline void update(uint8_t byte) noexcept {
+		crc = table(crc ^ byte) ^ (crc >> 4);
+		crc = table(crc ^ (byte >> 4)) ^ (crc >> 4);
+	}
+	inline type value() const noexcept { return ~crc; }
+	inline void reset() noexcept { crc = ~type(0); }
+private:
+	static inline type table(type i) noexcept {
+		static constexpr type nibble[16] = {
+			0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+			0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+			0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+			0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+		};
+		return nibble[i & 0xF];
+	}
+	type crc = ~type(0);
+};
+
+/**
+ * xxHash64, streaming variant with 32-byte stripes
+ */
+class xxh64 {
+public:
+	typedef uint64_t type;
+	inline xxh64(type seed = 0) noexcept : seed(seed) { reset(); }
+	void update(uint8_t byte) noexcept {
+		stripe[fill++] = byte;
+		++total;
+		if( fill < sizeof(stripe) ) return;
+		for(unsigned i = 0; i < 4; ++i)
+			acc[i] = round(acc[i], read64(stripe + i * 8));
+		fill = 0;
+	}
+	type value() const noexcept {
+		type h;
+		if( total >= sizeof(stripe) ) {
+			h = rotl(acc[0], 1) + rotl(acc[1], 7) +
+				rotl(acc[2], 12) + rotl(acc[3], 18);
+			for(unsigned i = 0; i < 4; ++i)
+				h = merge(h, acc[i]);
+		} else
+			h = seed + P5;
+		h += total;
+		unsigned i = 0;
+		for(; i + 8 <= fill; i += 8)
+			h = rotl(h ^ round(0, read64(stripe + i)), 27) * P1 + P4;
+		if( i + 4 <= fill ) {
+			h = rotl(h ^ (read32(stripe + i) * P1), 23) * P2 + P3;
+			i += 4;
+		}
+		for(; i < fill; ++i)
+			h = rotl(h ^ (stripe[i] * P5), 11) * P1;
+		h ^= h >> 33;
+		h *= P2;
+		h ^= h >> 29;
+		h *= P3;
+		h ^= h >> 32;
+		return h;
+	}
+	void reset() noexcept {
+		acc[0] = seed + P1 + P2;
+		acc[1] = seed + P2;
+		acc[2] = seed;
+		acc[3] = seed - P1;
+		total = 0;
+		fill = 0;
+	}
+private:
+	static constexpr type P1 = 11400714785074694791ULL;
+	static constexpr type P2 = 14029467366897019727ULL;
+	static constexpr type P3 =  1609587929392839161ULL;
+	static constexpr type P4 =  9650029242287828579ULL;
+	static constexpr type P5 =  2870177450012600261ULL;
+	static inline constexpr type rotl(type v, unsigned n) noexcept {
+		return (v << n) | (v >> (64 - n));
+	}
+	static inline constexpr type round(type acc, type input) noexcept {
+		return rotl(acc + input * P2, 31) * P1;
+	}
+	static inline constexpr type merge(type h, type acc) noexcept {
+		return (h ^ round(0, acc)) * P1 + P4;
+	}
+	static inline type read32(const uint8_t* p) noexcept {
+		return  type(p[0])        | (type(p[1]) << 8) |
+			   (type(p[2]) << 16) | (type(p[3]) << 24);
+	}
+	static inline type read64(const uint8_t* p) noexcept {
+		return read32(p) | (read32(p + 4) << 32);
+	}
+	type seed;
+	type acc[4];
+	type total;
+	uint8_t stripe[32];
+	unsigned fill;
+};
+}
+
+/**
+ * Updates digest H with characters passing to the next stream.
+ * Without the next stream it acts as a sink, computing the digest only.
+ * Characters wider than one byte are hashed in little-endian order
+ * Usage:
+ *   digest<hash::crc32> out(socket);
+ *   Object::structure().write(obj, out);
+ *   etag = out.value();
+ */
+template<class H>
+class digest : public details::ostream {
+public:
+	typedef typename H::type type;
+	inline digest() noexcept : next(nullptr) {}
+	inline digest(details::ostream& out, const H& h = H()) noexcept
+	  : next(&out), hash(h) {}
+	bool put(char_t c) noexcept {
+		if( next && ! next->put(c) ) return fail();
+		update(c);
+		return true;
+	}
+	bool write(const char_t* s, size_t n) noexcept {
+		if( next && ! next->write(s, n) ) return fail();
+		for(size_t i = 0; i < n; ++i) update(s[i]);
+		return true;
+	}
+	/** returns digest of characters written so far */
+	inline type value() const noexcept { return hash.value(); }
+	/** restarts digest computation */
+	inline void reset() noexcept { hash.reset(); }
+private:
+	inline void update(char_t c) noexcept {
+		using uchar_t = typename std::make_unsigned<char_t>::type;
+		uchar_t u = static_cast<uchar_t>(c);
+		for(unsigned i = 0; i < sizeof(char_t); ++i) {
+			hash.update(static_cast<uint8_t>(u));
+			u = static_cast<uchar_t>(u >> 8);
+		}
+	}
+	bool fail() noexcept {
+		ostream::error(next->error());
+		return false;
+	}
+	details::ostream* const next;
+	H hash;
+};
+
+/**
+ * Copies JSON text to the next stream without decoding values, removing
+ * whitespace or re-indenting it. Strings and scalars pass verbatim,
+ * characters that are kept are forwarded in bulk runs. The text is not
+ * validated, only brackets are counted. Top level values are separated
+ * with new lines.
+ * Usage:
+ *   reformat out(socket, 2);
+ *   out.write(text, size) && out.finish();
+ */
+class reformat : public details::ostream {
+public:
+	/** indent - spaces per level, 0 produces compact text */
+	inline reformat(details::ostream& out, unsigned indent = 0) noexcept
+	  : next(out), indent(indent) {}
+	bool put(char_t c) noexcept {
+		return write(&c, 1);
+	}
+	bool write(const char_t* s, size_t n) noexcept {
+		using namespace details;
+		size_t seg = 0, i = 0;	/* [seg, i) is copied unchanged */
+		while( i < n ) {
+			if( str.inside() ) {
+				i += str.scan(s + i, n - i);
+				if( ! str.inside() ) ended();
+				continue;
+			}
+			char_t c = s[i];
+			if( space(c) ) {
+				if( ! flush(s, seg, i) ) return false;
+				while( ++i < n && space(s[i]) );
+				seg = i;
+				if( scalar ) {
+					scalar = false;
+					ended();
+				}
+				continue;
+			}
+			if( scalar ) {
+				while( i < n && ! delimiter(s[i]) ) ++i;
+				if( i == n ) break;
+				scalar = false;
+				ended();
+				continue;
+			}
+			switch( c ) {
+			case literal::begin_array:
+			case literal::begin_object:
+				if( ! token(s, seg, i) ) return false;
+				++depth;
+				if( indent ) pending = opened;
+				break;
+			case literal::end_array:
+			case literal::end_object:
+				if( depth == 0 ) return fail(error_t::bad);
+				--depth;
+				pending = pending == opened || ! indent ? none : line;
+				if( ! token(s, seg, i) ) return false;
+				ended();
+				break;
+			case literal::value_separator:
+				if( indent ) pending = line;
+				break;
+			case literal::name_separator:
+				if( indent ) pending = blank;
+				break;
+			case literal::quotation_mark:
+				if( ! token(s, seg, i) ) return false;
+				str.open();
+				break;
+			default:
+				if( ! token(s, seg, i) ) return false;
+				scalar = true;
+				while( ++i < n && ! delimiter(s[i]) );
+				continue;
+			}
+			++i;
+		}
+		return flush(s, seg, n);
+	}
+	/** ends the text, returns false if it ends inside a string or
+	 *  a container, resets state for the next text				*/
+	bool finish() noexcept {
+		bool r = ! str.inside() && depth == 0;
+		str.reset();
+		scalar = false;
+		depth = 0;
+		pending = none;
+		return r || fail(details::error_t::bad);
+	}
+private:
+	enum pending_t : unsigned char {
+		none,		/* nothing to insert								*/
+		opened,		/* new line unless the container is empty			*/
+		line,		/* new line and indentation							*/
+		blank,		/* space after a name separator						*/
+		record		/* new line between top level values				*/
+	};
+	static inline bool space(char_t c) noexcept {
+		return c <= details::literal::ws && details::isws(c);
+	}
+	static inline bool delimiter(char_t c) noexcept {
+		using details::literal;
+		switch( c ) {
+		case literal::begin_array: case literal::end_array:
+		case literal::begin_object: case literal::end_object:
+		case literal::value_separator: case literal::name_separator:
+		case literal::quotation_mark:
+			return true;
+		default:
+			return space(c);
+		}
+	}
+	inline void ended() noexcept {
+		if( depth == 0 ) pending = record;
+	}
+	inline bool flush(const char_t* s, size_t seg, size_t i) noexcept {
+		return seg == i || next.write(s + seg, i - seg) || fail(next.error());
+	}
+	/* inserts pending separator before the character at i */
+	bool token(const char_t* s, size_t& seg, size_t i) noexcept {
+		if( pending == none ) return true;
+		if( ! flush(s, seg, i) ) return false;
+		seg = i;
+		pending_t p = pending;
+		pending = none;
+		switch( p ) {
+		case blank:
+			return next.put(details::literal::ws) || fail(next.error());
+		case record:
+			return next.put('\n') || fail(next.error());
+		default:
+			break;
+		}
+		static constexpr char_t spaces[] = {
+			' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ',
+			' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '
+		};
+		if( ! next.put('\n') ) return fail(next.error());
+		for(size_t k = depth * indent; k; ) {
+			size_t m = k < details::countof(spaces) ? k : details::countof(spaces);
+			if( ! next.write(spaces, m) ) return fail(next.error());
+			k -= m;
+		}
+		return true;
+	}
+	inline bool fail(details::error_t err) noexcept {
+		ostream::error(err);
+		return false;
+	}
+	details::ostream& next;
+	size_t depth = 0;
+	unsigned indent;
+	pending_t pending = none;
+	details::strscan str;
+	bool scalar = false;
+};
+
+}
+
+/**
+ * Copies JSON text from in to out with indent spaces per level,
+ * strings and scalars are not decoded. Stream windows are copied in bulk
+ */
+static inline bool Reformat(details::istream& in, details::ostream& out,
+		unsigned indent = 2) noexcept {
+	wrapper::reformat filter(out, indent);
+	for(;;) {
+		size_t n = 0;
+		const char_t* p = in.window(n);
+		if( p != nullptr && n != 0 ) {
+			if( ! filter.write(p, n) ) return false;
+			in.advance(n);
+			continue;
+		}
+		char_t buff[64];
+		size_t len = 0;
+		bool more;
+		while( (more = in.get(buff[len])) && ++len < details::countof(buff) );
+		if( len != 0 && ! filter.write(buff, len) ) return false;
+		if( ! more )
+			return buff[len] == details::iostate::eos_c && filter.finish();
+	}
+}
+
+/**
+ * Copies JSON text from in to out removing all insignificant whitespace
+ */
+static inline bool Minify(details::istream& in, details::ostream& out)
+		noexcept {
+	return Reformat(in, out, 0);
+}
+
+}
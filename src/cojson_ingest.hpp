@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_ingest.hpp - asynchronous bulk ingestion of JSON files (Linux)
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__has_include)
+#	if __has_include(<linux/io_uring.h>)
+#		include <linux/io_uring.h>
+#	endif
+#endif
+#include <cojson.hpp>
+
+#if defined(IORING_OFF_SQES) && defined(__NR_io_uring_setup)
+#	define COJSON_WITH_IO_URING
+#endif
+
+namespace cojson {
+namespace ingest {
+
+/**
+ * Outcome of ingesting a single file
+ */
+struct status {
+	int error;				/* errno of failed I/O, 0 on success 		*/
+	std::size_t size;		/* number of characters read 				*/
+	details::error_t parse;	/* errors reported by the lexer 			*/
+	bool read;				/* true if the document was bound 			*/
+};
+
+/**
+ * Minimal io_uring submission/completion wrapper, limited to vectored reads.
+ * valid() returns false when the kernel (or a sandbox) does not support it
+ */
+class uring {
+public:
+	explicit uring(unsigned entries) noexcept {
+#	ifdef COJSON_WITH_IO_URING
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		fd = syscall(__NR_io_uring_setup, entries, &params);
+		if( fd < 0 ) return;
+		sqlen = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqlen = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		single = params.features & IORING_FEAT_SINGLE_MMAP;
+		if( single ) sqlen = cqlen = sqlen > cqlen ? sqlen : cqlen;
+		sq = map(sqlen, IORING_OFF_SQ_RING);
+		cq = single ? sq : map(cqlen, IORING_OFF_CQ_RING);
+		sqes = static_cast<io_uring_sqe*>(map(
+			params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+		sqelen = params.sq_entries * sizeof(io_uring_sqe);
+		if( sq == nullptr || cq == nullptr || sqes == nullptr ) {
+			release();
+			return;
+		}
+		sqhead  = field(sq, params.sq_off.head);
+		sqtail  = field(sq, params.sq_off.tail);
+		sqmask  = *field(sq, params.sq_off.ring_mask);
+		sqarray = field(sq, params.sq_off.array);
+		sqsize  = params.sq_entries;
+		cqhead  = field(cq, params.cq_off.head);
+		cqtail  = field(cq, params.cq_off.tail);
+		cqmask  = *field(cq, params.cq_off.ring_mask);
+		cqes	= reinterpret_cast<io_uring_cqe*>(
+					static_cast<char*>(cq) + params.cq_off.cqes);
+#	else
+		(void) entries;
+#	endif
+	}
+	inline ~uring() noexcept { release(); }
+	uring(const uring&) = delete;
+	uring& operator=(const uring&) = delete;
+
+	inline bool valid() const noexcept { return fd >= 0; }
+
+	/** queues a read of one iovec, returns false if the queue is full */
+	bool read(int file, const iovec* iov, off_t offset,
+			std::uint64_t tag) noexcept {
+#	ifdef COJSON_WITH_IO_URING
+		unsigned tail = *sqtail;
+		if( tail - __atomic_load_n(sqhead, __ATOMIC_ACQUIRE) >= sqsize )
+			return false;
+		unsigned index = tail & sqmask;
+		io_uring_sqe& sqe = sqes[index];
+		memset(&sqe, 0, sizeof(sqe));
+		sqe.opcode = IORING_OP_READV;
+		sqe.fd = file;
+		sqe.off = offset;
+		sqe.addr = reinterpret_cast<std::uintptr_t>(iov);
+		sqe.len = 1;
+		sqe.user_data = tag;
+		sqarray[index] = index;
+		__atomic_store_n(sqtail, tail + 1, __ATOMIC_RELEASE);
+		++pending;
+		return true;
+#	else
+		(void) file; (void) iov; (void) offset; (void) tag;
+		return false;
+#	endif
+	}
+
+	/** submits queued reads and waits for at least one completion */
+	bool submit() noexcept {
+#	ifdef COJSON_WITH_IO_URING
+		int r;
+		do r = syscall(__NR_io_uring_enter, fd, pending, 1,
+				IORING_ENTER_GETEVENTS, nullptr, 0);
+		while( r < 0 && errno == EINTR );
+		if( r < 0 ) return false;
+		pending -= static_cast<unsigned>(r) < pending ? r : pending;
+		return true;
+#	else
+		return false;
+#	endif
+	}
+
+	/** passes completions to f(tag, result), returns their count */
+	template<class F>
+	unsigned reap(F f) noexcept {
+		unsigned n = 0;
+#	ifdef COJSON_WITH_IO_URING
+		unsigned head = *cqhead;
+		while( head != __atomic_load_n(cqtail, __ATOMIC_ACQUIRE) ) {
+			const io_uring_cqe& cqe = cqes[head & cqmask];
+			f(cqe.user_data, cqe.res);
+			__atomic_store_n(cqhead, ++head, __ATOMIC_RELEASE);
+			++n;
+		}
+#	else
+		(void) f;
+#	endif
+		return n;
+	}
+private:
+#	ifdef COJSON_WITH_IO_URING
+	void* map(std::size_t length, off_t offset) noexcept {
+		void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, offset);
+		return p == MAP_FAILED ? nullptr : p;
+	}
+	static inline unsigned* field(void* base, unsigned offset) noexcept {
+		return reinterpret_cast<unsigned*>(static_cast<char*>(base) + offset);
+	}
+#	endif
+	void release() noexcept {
+#	ifdef COJSON_WITH_IO_URING
+		if( sqes ) munmap(sqes, sqelen);
+		if( cq && ! single ) munmap(cq, cqlen);
+		if( sq ) munmap(sq, sqlen);
+		sq = cq = nullptr;
+		sqes = nullptr;
+#	endif
+		if( fd >= 0 ) close(fd);
+		fd = -1;
+	}
+	int fd = -1;
+#	ifdef COJSON_WITH_IO_URING
+	void* sq = nullptr;
+	void* cq = nullptr;
+	io_uring_sqe* sqes = nullptr;
+	io_uring_cqe* cqes = nullptr;
+	std::size_t sqlen = 0, cqlen = 0, sqelen = 0;
+	bool single = false;
+	unsigned* sqhead = nullptr;
+	unsigned* sqtail = nullptr;
+	unsigned* sqarray = nullptr;
+	unsigned* cqhead = nullptr;
+	unsigned* cqtail = nullptr;
+	unsigned sqmask = 0, cqmask = 0, sqsize = 0;
+	unsigned pending = 0;
+#	endif
+};
+
+/**
+ * Reads a list of files and binds each one into an instance of C.
+ * The calling thread keeps up to depth reads in flight with io_uring
+ * (or reads them with pread when io_uring is unavailable) and hands
+ * completed buffers to a pool of parser threads.
+ * Results are passed to sink(index, C&, const status&), called from
+ * parser threads concurrently
+ */
+template<class C>
+class pipeline {
+	static_assert(sizeof(char_t) == 1, "ingestion requires char_t of one byte");
+public:
+	/**
+	 * structure - class descriptor for C
+	 * workers   - number of parser threads, 0 for hardware concurrency
+	 * depth     - maximal number of reads in flight and buffers parked
+	 * uring     - false to force the pread fallback
+	 */
+	pipeline(const details::clas<C>& structure, unsigned workers = 0,
+			unsigned depth = 16, bool uring = true) noexcept
+	  : structure(structure),
+		workers(workers ? workers : std::thread::hardware_concurrency()),
+		depth(depth ? depth : 1), withuring(uring) {
+		if( this->workers == 0 ) this->workers = 1;
+	}
+
+	/** true if the last run used io_uring */
+	inline bool asynchronous() const noexcept { return async; }
+
+	/** ingests count files, returns number of documents read successfully */
+	template<class Sink>
+	std::size_t run(const char* const paths[], std::size_t count, Sink sink) {
+		queue jobs(depth);
+		std::vector<std::thread> pool;
+		std::size_t good = 0;
+		std::mutex guard;
+		for(unsigned i = 0; i < workers; ++i)
+			pool.emplace_back([this, &jobs, &sink, &good, &guard]() {
+				std::size_t n = parse(jobs, sink);
+				std::lock_guard<std::mutex> lock(guard);
+				good += n;
+			});
+		feed(paths, count, jobs);
+		jobs.close();
+		for(auto& t : pool) t.join();
+		return good;
+	}
+
+private:
+	struct job {
+		std::size_t index;
+		int fd;
+		int error;
+		std::size_t size;
+		std::size_t done;
+		iovec iov;
+		std::unique_ptr<char_t[]> data;
+		inline void finish(int err) noexcept {
+			if( err ) error = err;
+			if( fd >= 0 ) ::close(fd);
+			fd = -1;
+		}
+	};
+	typedef std::unique_ptr<job> jobptr;
+
+	/** bounded hand-off between the reading and the parsing threads */
+	class queue {
+	public:
+		inline explicit queue(unsigned limit) noexcept : limit(limit) {}
+		void push(jobptr j) {
+			std::lock_guard<std::mutex> lock(mutex);
+			items.push_back(std::move(j));
+			++parked;
+			ready.notify_one();
+		}
+		jobptr pop() {
+			std::unique_lock<std::mutex> lock(mutex);
+			ready.wait(lock, [this]() { return closed || ! items.empty(); });
+			if( items.empty() ) return jobptr();
+			jobptr j = std::move(items.front());
+			items.pop_front();
+			return j;
+		}
+		/* called by a parser when it is done with a job */
+		void release() {
+			std::lock_guard<std::mutex> lock(mutex);
+			--parked;
+			room.notify_one();
+		}
+		/* waits until the number of parked buffers drops below limit */
+		void await(unsigned inflight) {
+			std::unique_lock<std::mutex> lock(mutex);
+			room.wait(lock, [this, inflight]() {
+				return parked + inflight < limit; });
+		}
+		bool full(unsigned inflight) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return parked + inflight >= limit;
+		}
+		void close() {
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+			ready.notify_all();
+		}
+	private:
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::condition_variable room;
+		std::deque<jobptr> items;
+		unsigned limit;
+		unsigned parked = 0;
+		bool closed = false;
+	};
+
+	/* opens a file and allocates its buffer, returns false on failure */
+	static bool open(job& j, const char* path) {
+		j.fd = ::open(path, O_RDONLY | O_CLOEXEC);
+		if( j.fd < 0 ) {
+			j.error = errno;
+			return false;
+		}
+		struct stat st;
+		if( fstat(j.fd, &st) != 0 ) {
+			j.finish(errno);
+			return false;
+		}
+		j.size = st.st_size;
+		j.data.reset(new char_t[j.size + 1]);
+		j.data[j.size] = 0;
+		return j.size != 0;
+	}
+
+	/* reads the remainder of a file synchronously */
+	static void pread(job& j) noexcept {
+		while( j.done < j.size ) {
+			ssize_t r = ::pread(j.fd, j.data.get() + j.done,
+					j.size - j.done, j.done);
+			if( r < 0 && errno == EINTR ) continue;
+			if( r < 0 ) { j.finish(errno); return; }
+			if( r == 0 ) break;
+			j.done += r;
+		}
+		j.finish(0);
+	}
+
+	/* queues read of the remainder, iovec must stay valid until completion */
+	static bool submit(uring& ring, job& j, std::uint64_t tag) noexcept {
+		j.iov.iov_base = j.data.get() + j.done;
+		j.iov.iov_len = j.size - j.done;
+		return ring.read(j.fd, &j.iov, j.done, tag);
+	}
+
+	void feed(const char* const paths[], std::size_t count, queue& jobs) {
+		uring ring(withuring ? depth : 0);
+		async = withuring && ring.valid();
+		std::vector<jobptr> slots(depth);
+		unsigned active = 0;
+		std::size_t next = 0;
+		while( next < count || active ) {
+			while( next < count && active < depth && ! jobs.full(active) ) {
+				jobptr j(new job{next, -1, 0, 0, 0, {}, nullptr});
+				bool readable = open(*j, paths[next++]);
+				if( readable && async ) {
+					unsigned slot = 0;
+					while( slots[slot] ) ++slot;
+					if( submit(ring, *j, slot) ) {
+						slots[slot] = std::move(j);
+						++active;
+						continue;
+					}
+				}
+				if( readable ) pread(*j);
+				else j->finish(0);
+				jobs.push(std::move(j));
+			}
+			if( active == 0 ) {
+				if( next < count ) jobs.await(0);
+				continue;
+			}
+			if( ! ring.submit() ) {
+				/* ring is broken, complete reads synchronously */
+				for(auto& j : slots) if( j ) {
+					pread(*j);
+					jobs.push(std::move(j));
+				}
+				active = 0;
+				async = false;
+				continue;
+			}
+			ring.reap([&](std::uint64_t tag, int res) {
+				job& j = *slots[tag];
+				if( res == -EINTR || res == -EAGAIN ) {
+					if( submit(ring, j, tag) ) return;
+					res = -EAGAIN;
+				}
+				if( res > 0 ) {
+					j.done += res;
+					if( j.done < j.size && submit(ring, j, tag) ) return;
+				}
+				j.finish(res < 0 ? -res : 0);
+				jobs.push(std::move(slots[tag]));
+				--active;
+			});
+		}
+	}
+
+	template<class Sink>
+	std::size_t parse(queue& jobs, Sink& sink) {
+		std::size_t good = 0;
+		while( jobptr j = jobs.pop() ) {
+			std::unique_ptr<C> obj(new C());
+			status st { j->error, j->done, details::error_t::noerror, false };
+			if( ! j->error && j->done ) {
+				wrapper::buffer in(j->data.get(),
+						static_cast<cojson::size_t>(j->done));
+				details::lexer lex(in);
+				st.read = structure.read(*obj, lex);
+				st.parse = lex.error();
+			} else if( ! j->error )
+				st.parse = details::error_t::eof;
+			j->data.reset();
+			jobs.release();
+			if( st.read ) ++good;
+			sink(j->index, *obj, st);
+		}
+		return good;
+	}
+
+	const details::clas<C>& structure;
+	unsigned workers;
+	unsigned depth;
+	bool withuring;
+	bool async = false;
+};
+
+}
+}
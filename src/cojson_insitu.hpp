@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_insitu.hpp - in-situ strings viewing into the input buffer
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <string.h>
+#include <cojson.hpp>
+
+namespace cojson {
+
+/**
+ * A string read in situ: it points into the input buffer instead of
+ * being copied. Escaped strings are decoded in place, overwriting
+ * the input, the closing quotation mark is replaced with terminating 0.
+ * The input must be a single mutable contiguous buffer read via stream
+ * windows, such as details::buffer over char_t* and size. The view is
+ * valid while the buffer is. Other streams, including segmented ones,
+ * fail the read with noobject.
+ * Usage:
+ *   struct Item { view name; ... };
+ *   P<Item, Name::name, view, &Item::name>
+ */
+class view {
+public:
+	inline view() noexcept : ptr(nullptr), len(0) {}
+	/** characters of the string, zero terminated, nullptr if null	*/
+	inline const char_t* data() const noexcept { return ptr; }
+	inline const char_t* c_str() const noexcept { return ptr; }
+	inline size_t size() const noexcept { return len; }
+	inline bool empty() const noexcept { return len == 0; }
+	inline const char_t* begin() const noexcept { return ptr; }
+	inline const char_t* end() const noexcept { return ptr + len; }
+	inline char_t operator[](size_t i) const noexcept { return ptr[i]; }
+
+	bool read(details::lexer& in) noexcept {
+		using namespace details;
+		ptr = nullptr;
+		len = 0;
+		ctype ct;
+		if( ! isvalid(ct = in.value(ctype::stringnull)) ) return in.skip();
+		if( ct == ctype::null ) {
+			if( ! config::null_is_error ) return true;
+			in.error(error_t::mismatch);
+			return false;
+		}
+		char_t chr;
+		in.skipws(chr);	/* the quotation mark held by value */
+		size_t n = ~size_t(0);
+		const char_t* run = in.contiguous() ? in.run(n) : nullptr;
+		if( run == nullptr ) {
+			in.error(error_t::noobject);
+			return in.skip_string(false);
+		}
+		char_t* const first = const_cast<char_t*>(run);
+		char_t* dst = first;
+		const char_t* next = run;	/* where the input goes on in the buffer */
+		for(;;) {
+			/* runs must follow each other, decoding never gets ahead */
+			if( run != next ) {
+				in.error(error_t::noobject);
+				return in.skip_string(false);
+			}
+			if( run != dst ) memmove(dst, run, n * sizeof(char_t));
+			dst += n;
+			in.consume(n);
+			next = run + n;
+			ct = in.string(chr, false);
+			if( ct == ctype::delim ) break;
+			if( ! hasbits(ct, ctype::string | ctype::hex) ) return false;
+			/* the escape, or a control character, was taken from next */
+			next += next[0] != literal::escape ? 1
+				: next[1] == literal::hex_mark ? 6 : 2;
+			*dst++ = chr;
+			if( hasbits(ct, ctype::hex) ) *dst++ = in.hexremainder();
+			n = ~size_t(0);
+			if( (run = in.run(n)) == nullptr ) {
+				run = next;
+				n = 0;
+			}
+		}
+		*dst = 0;
+		ptr = first;
+		len = dst - first;
+		return true;
+	}
+
+	bool write(details::ostream& out) const noexcept {
+		using namespace details;
+		if( ptr == nullptr ) return details::value::null(out);
+		bool r = out.put(literal::quotation_mark);
+		for(const char_t* s = ptr; r && s != end(); ) {
+			/* pass plain characters in bulk */
+			const char_t* run = s;
+			while( s != end() && ! literal::is_control(*s) &&
+				! literal::is_escaped(*s) ) ++s;
+			if( s != run ) r = out.write(run, s - run);
+			if( r && s != end() ) r = writer<const char_t*>::write(*s++, out);
+		}
+		return r && out.put(literal::quotation_mark);
+	}
+private:
+	const char_t* ptr;
+	size_t len;
+};
+
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_intern.hpp - interned strings for repeated values
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <cojson.hpp>
+
+namespace cojson {
+namespace intern {
+
+/** FNV-1a hash, fed character by character while decoding */
+struct hash {
+	inline void add(char_t c) noexcept {
+		value ^= static_cast<uint32_t>(c);
+		value *= 16777619u;
+	}
+	inline void add(const char_t* s, size_t n) noexcept {
+		while( n-- ) add(*s++);
+	}
+	uint32_t value = 2166136261u;
+};
+
+/**
+ * Bounded hash-consing pool of strings. Each distinct string is stored
+ * once, in Bytes of storage, and found through Slots (a power of 2) slots
+ * of open addressing. Strings never move or go away while the pool lives,
+ * so the pointers returned may be compared for equality.
+ * Lookup is lock-free and insertion takes one CAS. Threads that add
+ * the same string at once may each take storage for it, only one copy
+ * is kept. Strings longer than Length are not interned.
+ * Usage:
+ *   static intern::pool<> labels;
+ */
+template<size_t Slots = 256, size_t Bytes = 4096, size_t Length = 64>
+class pool {
+	static_assert((Slots & (Slots - 1)) == 0, "Slots must be a power of 2");
+	struct entry {
+		uint32_t hash;
+		uint32_t len;
+	};
+public:
+	static constexpr size_t length = Length;
+	inline pool() noexcept : top(0), entries(0) {
+		for(auto& slot : slots) slot.store(nullptr, std::memory_order_relaxed);
+	}
+	pool(const pool&) = delete;
+	pool& operator=(const pool&) = delete;
+
+	/** returns the interned copy of text of len characters with hash h,
+	 *  adding it if not yet there, or nullptr if the pool is full		*/
+	const char_t* add(const char_t* text, size_t len, uint32_t h) noexcept {
+		if( len > Length ) return nullptr;
+		const entry* fresh = nullptr;
+		size_t i = h & (Slots - 1);
+		for(size_t n = 0; n < Slots; ++n, i = (i + 1) & (Slots - 1)) {
+			const entry* e = slots[i].load(std::memory_order_acquire);
+			if( e == nullptr ) {
+				if( fresh == nullptr && (fresh = make(text, len, h)) == nullptr )
+					return nullptr;
+				if( slots[i].compare_exchange_strong(e, fresh,
+						std::memory_order_acq_rel, std::memory_order_acquire) ) {
+					entries.fetch_add(1, std::memory_order_relaxed);
+					return textof(fresh);
+				}
+				/* e is now the entry another thread placed here */
+			}
+			if( e->hash == h && e->len == len &&
+				memcmp(textof(e), text, len * sizeof(char_t)) == 0 )
+				return textof(e);
+		}
+		return nullptr;
+	}
+	inline const char_t* add(const char_t* text) noexcept {
+		size_t len = 0;
+		hash h;
+		while( text[len] ) h.add(text[len++]);
+		return add(text, len, h.value);
+	}
+	/** length of an interned string */
+	static inline size_t size(const char_t* text) noexcept {
+		return (reinterpret_cast<const entry*>(text) - 1)->len;
+	}
+	/** number of strings interned */
+	inline size_t count() const noexcept {
+		return entries.load(std::memory_order_relaxed);
+	}
+	/** bytes of storage taken */
+	inline size_t used() const noexcept {
+		size_t n = top.load(std::memory_order_relaxed);
+		return n < Bytes ? n : Bytes;
+	}
+private:
+	static inline const char_t* textof(const entry* e) noexcept {
+		return reinterpret_cast<const char_t*>(e + 1);
+	}
+	/* takes storage for an entry, nullptr if exhausted */
+	const entry* make(const char_t* text, size_t len, uint32_t h) noexcept {
+		size_t n = sizeof(entry) + (len + 1) * sizeof(char_t);
+		n = (n + alignof(entry) - 1) & ~(alignof(entry) - 1);
+		size_t at = top.fetch_add(n, std::memory_order_relaxed);
+		if( at + n > Bytes ) return nullptr;
+		entry* e = reinterpret_cast<entry*>(storage + at);
+		e->hash = h;
+		e->len = static_cast<uint32_t>(len);
+		char_t* dst = reinterpret_cast<char_t*>(e + 1);
+		memcpy(dst, text, len * sizeof(char_t));
+		dst[len] = 0;
+		return e;
+	}
+	std::atomic<const entry*> slots[Slots];
+	std::atomic<size_t> top;
+	std::atomic<size_t> entries;
+	alignas(entry) unsigned char storage[Bytes];
+};
+
+/**
+ * A string property interned in pool returned by Get: a pointer-sized
+ * handle, equal strings have equal handles. The string is decoded onto
+ * the stack hashing as it goes, so a string already in the pool takes
+ * no storage. A string longer than Pool::length, or not fitting in a full
+ * pool, is read as null with overrun.
+ * Usage:
+ *   static intern::pool<>& labels() noexcept { static intern::pool<> p; return p; }
+ *   struct Station { intern::string<intern::pool<>, labels> mode; ... };
+ *   P<Station, Name::mode, intern::string<intern::pool<>, labels>,
+ *   	&Station::mode>
+ */
+template<class Pool, Pool& Get() noexcept>
+class string {
+public:
+	inline string() noexcept : ptr(nullptr) {}
+	/** the interned string, nullptr if null */
+	inline const char_t* c_str() const noexcept { return ptr; }
+	inline size_t size() const noexcept { return ptr ? Pool::size(ptr) : 0; }
+	inline bool empty() const noexcept { return size() == 0; }
+	inline bool operator==(const string& that) const noexcept {
+		return ptr == that.ptr;
+	}
+	inline bool operator!=(const string& that) const noexcept {
+		return ptr != that.ptr;
+	}
+	/** interns a string given in C++ */
+	inline string& operator=(const char_t* text) noexcept {
+		ptr = text ? Get().add(text) : nullptr;
+		return *this;
+	}
+
+	bool read(details::lexer& in) noexcept {
+		using namespace details;
+		ptr = nullptr;
+		ctype ct;
+		if( ! isvalid(ct = in.value(ctype::stringnull)) ) return in.skip();
+		if( ct == ctype::null ) {
+			if( ! config::null_is_error ) return true;
+			in.error(error_t::mismatch);
+			return false;
+		}
+		char_t buf[Pool::length + 1];
+		size_t len = 0;
+		hash h;
+		bool first = true;
+		char_t chr;
+		while( hasbits((ct = in.string(chr, first)), ctype::string | ctype::hex) ) {
+			first = false;
+			if( len == Pool::length ) {
+				in.error(error_t::overrun);
+				return in.skip_string(false);
+			}
+			h.add(buf[len++] = chr);
+			if( hasbits(ct, ctype::hex) ) {
+				if( len == Pool::length ) {
+					in.error(error_t::overrun);
+					return in.skip_string(false);
+				}
+				h.add(buf[len++] = in.hexremainder());
+			}
+			/* plain characters in bulk */
+			size_t n = Pool::length - len;
+			const char_t* run = in.run(n);
+			if( run != nullptr && n != 0 ) {
+				memcpy(buf + len, run, n * sizeof(char_t));
+				h.add(run, n);
+				len += n;
+				in.consume(n);
+			}
+		}
+		if( ct != ctype::delim ) return false;
+		if( (ptr = Get().add(buf, len, h.value)) == nullptr )
+			in.error(error_t::overrun);
+		return true;
+	}
+	bool write(details::ostream& out) const noexcept {
+		return ptr ? details::writer<const char_t*>::write(ptr, out)
+			: details::value::null(out);
+	}
+private:
+	const char_t* ptr;
+};
+
+}}
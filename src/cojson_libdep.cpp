@@ -172,7 +172,11 @@ template<>
 inline bool write_double_impl<config::write_double_impl_is::with_sprintf>(
 		const double& val, ostream& out) noexcept {
 	temporary_s<char, config::sprintf_buffer_size,
-					  config::sprintf_buffer_static> tmp;
+				temporary_policy(config::sprintf_buffer_static)> tmp;
+	if( ! tmp.good() ) {
+		out.error(error_t::noobject);
+		return false;
+	}
 	if( ! any<char>::gfmt(tmp, tmp.size, val) ) {
 		out.error(error_t::overrun);
 		return false;
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_ndjson.hpp - newline-delimited JSON records reader and writer
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <string.h>
+#include <cojson.hpp>
+
+namespace cojson {
+namespace ndjson {
+
+static constexpr char_t newline = '\n';
+
+/**
+ * Input stream limited to a single line of the underlying stream,
+ * the newline character is seen as end of stream.
+ * Windows of the underlying stream are clamped at the newline,
+ * so runs never span it
+ */
+class line : public details::istream {
+public:
+	inline line(details::istream& in) noexcept
+	  : in(in), end(false), last(false) {}
+	bool get(char_t& c) noexcept {
+		using namespace details;
+		if( ! end ) {
+			if( in.get(c) ) {
+				if( c != newline ) return true;
+			} else {
+				if( in.error() != error_t::eof ) istream::error(in.error());
+				last = true;
+			}
+			end = true;
+		}
+		c = iostate::eos_c;
+		istream::error(error_t::eof);
+		return false;
+	}
+	const char_t* window(size_t& n) noexcept {
+		if( end ) {
+			n = 0;
+			return nullptr;
+		}
+		const char_t* w = in.window(n);
+		if( w == nullptr ) return nullptr;
+		size_t i = eol(w, n);
+		if( i == 0 && n != 0 ) {
+			/* the newline is at the head, the record ends here */
+			in.advance(1);
+			end = true;
+			n = 0;
+			return nullptr;
+		}
+		n = i;
+		return w;
+	}
+	void advance(size_t n) noexcept {
+		in.advance(n);
+	}
+	bool windowed() const noexcept {
+		return in.windowed();
+	}
+	/* windows are parts of the underlying ones */
+	bool contiguous() const noexcept {
+		return in.contiguous();
+	}
+	/** skips remainder of the current line and moves to the next one,
+	 *  returns false if the underlying stream is exhausted */
+	bool next() noexcept {
+		char_t c;
+		while( ! end ) get(c);
+		end = last;
+		clear();
+		return ! last;
+	}
+	/** true if the underlying stream is exhausted */
+	inline bool exhausted() const noexcept { return last; }
+private:
+	/* position of the first newline in p[0..n) or n */
+	template<typename C>
+	static inline size_t eol(const C* p, size_t n) noexcept {
+		size_t i = 0;
+		while( i < n && p[i] != newline ) ++i;
+		return i;
+	}
+	static inline size_t eol(const char* p, size_t n) noexcept {
+		const void* q = memchr(p, newline, n);
+		return q ? static_cast<const char*>(q) - p : n;
+	}
+	details::istream& in;
+	bool end;
+	bool last;
+};
+
+/**
+ * Reads NDJSON records, one per line, into objects of class T,
+ * reusing a single lexer for all records. Empty lines are skipped,
+ * a malformed line affects only its own record.
+ * Members absent in a record keep values from previous records
+ * Usage:
+ *   ndjson::reader<Log> in(Log::structure(), stream);
+ *   while( in.next(log) ) if( in.good() ) process(log);
+ */
+template<class T>
+class reader {
+public:
+	inline reader(const details::clas<T>& structure, details::istream& in)
+	  noexcept : structure(structure), input(in), lex(input), number(0) {}
+
+	/** reads next record into obj, returns false at end of input.
+	 *  error() tells if the record was bound successfully */
+	bool next(T& obj) noexcept {
+		using namespace details;
+		char_t c;
+		while( ! input.exhausted() ) {
+			++number;
+			lex.restart();
+			if( lex.skipws(c) ) {
+				lex.back(c);
+				bool r = structure.read(obj, lex);
+				/* only whitespace may follow the record on the same line */
+				if( r && lex.skipws(c) ) lex.error(error_t::bad);
+				if( ! r && lex.error() == error_t::noerror )
+					lex.error(error_t::bad);
+				status = lex.error();
+				input.next();
+				return true;
+			}
+			input.next();
+		}
+		status = error_t::noerror;
+		return false;
+	}
+
+	/** calls f(obj, error, line) for each record,
+	 *  returns number of records bound successfully */
+	template<class F>
+	size_t each(T& obj, F f) noexcept {
+		size_t n = 0;
+		while( next(obj) ) {
+			if( good() ) ++n;
+			f(obj, status, number);
+		}
+		return n;
+	}
+
+	/** errors of the last record */
+	inline details::error_t error() const noexcept { return status; }
+	inline bool good() const noexcept {
+		return status == details::error_t::noerror;
+	}
+	/** number of the line last record was read from, starting from 1 */
+	inline size_t lineno() const noexcept { return number; }
+private:
+	const details::clas<T>& structure;
+	line input;
+	details::lexer lex;
+	size_t number;
+	details::error_t status = details::error_t::noerror;
+};
+
+/**
+ * Writes objects of class T as NDJSON records, one per line
+ */
+template<class T>
+class writer {
+public:
+	inline writer(const details::clas<T>& structure, details::ostream& out)
+	  noexcept : structure(structure), out(out), number(0) {}
+	/** appends a record */
+	bool write(const T& obj) noexcept {
+		if( ! structure.write(obj, out) || ! out.put(newline) ) return false;
+		++number;
+		return true;
+	}
+	/** number of records written */
+	inline size_t count() const noexcept { return number; }
+private:
+	const details::clas<T>& structure;
+	details::ostream& out;
+	size_t number;
+};
+
+}
+}
@@ -0,0 +1,613 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_parallel.hpp - multi-threaded parsing of large inputs
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <deque>
+#include <cojson_ndjson.hpp>
+#if defined(__unix__)
+#	include <errno.h>
+#	include <limits.h>
+#	include <sys/uio.h>
+#endif
+
+namespace cojson {
+namespace parallel {
+
+/*
+ * Shared state audit. Workers share only read-only data:
+ * - descriptors (clas, property, value) are function-local statics,
+ *   initialized once and never modified
+ * - the chartype table is either constant or built at static init
+ * Each worker owns its lexer, input stream and destination objects.
+ * Static temporaries would be shared by all threads, so they are
+ * rejected at compile time, per thread temporaries are fine
+ */
+static_assert(details::temporary_policy(
+	configuration::Configuration<details::lexer>::temporary_static) !=
+		config::temporary_is::statical,
+	"Parallel parsing requires non-static lexer temporaries");
+static_assert(details::temporary_policy(config::sprintf_buffer_static) !=
+		config::temporary_is::statical,
+	"Parallel parsing requires non-static sprintf buffer");
+
+/**
+ * Worker threads of one parallel run, all joined when the run is over,
+ * even if it is left with an exception. Workers that could not be
+ * started are reported to the caller, which runs their share itself
+ */
+class team {
+public:
+	inline team() noexcept {}
+	team(const team&) = delete;
+	team& operator=(const team&) = delete;
+	inline ~team() noexcept { join(); }
+	/** starts threads running work(i) for i in [1, n), stops at the first
+	 *  thread that fails to start. returns number of workers running,
+	 *  including the caller as worker 0									*/
+	template<class F>
+	unsigned start(unsigned n, F& work) noexcept {
+		__try {
+			pool.reserve(n);
+			for(unsigned i = 1; i < n; ++i) pool.emplace_back(work, i);
+		} __catch(...) {}
+		return pool.size() + 1;
+	}
+	/** waits for all started threads */
+	inline void join() noexcept {
+		for(auto& t : pool) t.join();
+		pool.clear();
+	}
+private:
+	std::vector<std::thread> pool;
+};
+
+/**
+ * Parses a contiguous NDJSON text (a buffer or a mapped file) on several
+ * threads. The text is split at record boundaries into chunks, workers
+ * take chunks in turns and bind records into per-chunk vectors,
+ * which are concatenated in input order.
+ * Malformed records are counted and skipped. The text is not modified,
+ * so in-situ views (cojson_insitu.hpp) cannot be bound from it
+ * Usage:
+ *   parallel::ndjson<Log> parser(Log::structure());
+ *   std::vector<Log> logs;
+ *   parser.read(data, size, logs);
+ */
+template<class T>
+class ndjson {
+public:
+	/**
+	 * structure - class descriptor for T
+	 * threads   - number of worker threads, 0 for hardware concurrency
+	 * chunk     - approximate chunk size in characters
+	 */
+	ndjson(const details::clas<T>& structure, unsigned threads = 0,
+			std::size_t chunk = 1 << 20) noexcept
+	  : structure(structure),
+		workers(threads ? threads : std::thread::hardware_concurrency()),
+		chunk(chunk ? chunk : 1) {
+		if( workers == 0 ) workers = 1;
+		/* chunk length must fit cojson::size_t */
+		if( this->chunk > limit ) this->chunk = limit;
+	}
+
+	/** parses size characters from data, appends records to out.
+	 *  returns true if all records were bound successfully			*/
+	bool read(const char_t* data, std::size_t size, std::vector<T>& out)
+			noexcept {
+		std::atomic<std::size_t> malformed(0);
+		bool ok = true;
+		__try {
+			std::vector<range> chunks = split(data, size);
+			std::vector<std::vector<T>> parts(chunks.size());
+			std::atomic<std::size_t> next(0);
+			std::atomic<bool> good(true);
+			/* chunks are taken in turns, any number of workers will do */
+			auto work = [&](unsigned) noexcept {
+				std::size_t i;
+				while( (i = next++) < chunks.size() )
+					if( ! parse(chunks[i], parts[i], malformed) )
+						good = false;
+			};
+			team crew;
+			unsigned n = workers < chunks.size() ? workers : chunks.size();
+			crew.start(n, work);
+			work(0);
+			crew.join();
+			std::size_t total = out.size();
+			for(const auto& p : parts) total += p.size();
+			out.reserve(total);
+			for(auto& p : parts)
+				for(auto& r : p) out.push_back(std::move(r));
+			ok = good;
+		} __catch(...) {
+			ok = false;
+		}
+		failures = malformed;
+		return ok && failures == 0;
+	}
+
+	/** number of malformed records in the last read */
+	inline std::size_t failed() const noexcept { return failures; }
+	/** number of worker threads */
+	inline unsigned threads() const noexcept { return workers; }
+private:
+	static constexpr std::size_t limit =
+		std::numeric_limits<cojson::size_t>::max();
+	struct range {
+		const char_t* data;
+		std::size_t size;
+	};
+
+	/* splits text in chunks ending with a newline or at the end of text */
+	std::vector<range> split(const char_t* data, std::size_t size) const {
+		std::vector<range> chunks;
+		std::size_t pos = 0;
+		while( pos < size ) {
+			std::size_t end = size - pos > chunk ? pos + chunk : size;
+			while( end < size && data[end - 1] != cojson::ndjson::newline ) ++end;
+			if( end - pos > limit ) end = pos + limit;
+			chunks.push_back(range{data + pos, end - pos});
+			pos = end;
+		}
+		return chunks;
+	}
+
+	/* parses records of one chunk into a vector */
+	bool parse(const range& r, std::vector<T>& dst,
+			std::atomic<std::size_t>& malformed) const noexcept {
+		T obj {};
+		/* the text is read only, in-situ views are not bound from it */
+		const wrapper::segment text[] = {
+			{ r.data, static_cast<cojson::size_t>(r.size) } };
+		wrapper::segments in(text);
+		cojson::ndjson::reader<T> records(structure, in);
+		__try {
+			while( records.next(obj) ) {
+				if( records.good() ) dst.push_back(obj);
+				else ++malformed;
+				obj = T {};
+			}
+		} __catch(...) {
+			return false;
+		}
+		return true;
+	}
+
+	const details::clas<T>& structure;
+	unsigned workers;
+	std::size_t chunk;
+	std::size_t failures = 0;
+};
+
+/**
+ * Parses one large top-level array of objects on several threads.
+ * A structural pre-scan, tracking strings and escapes, locates element
+ * boundaries; element ranges are dealt out to workers in equal slices
+ * and a worker that runs out of work steals half of the remaining slice
+ * of another worker. Each element is bound by clas<T> into its slot
+ * of the destination vector, preallocated to the number of elements.
+ * The text is not modified, so in-situ views cannot be bound from it
+ * Usage:
+ *   parallel::array<Device> parser(Device::structure());
+ *   std::vector<Device> devices;
+ *   parser.read(data, size, devices);
+ */
+template<class T>
+class array {
+public:
+	/**
+	 * structure - class descriptor for T
+	 * threads   - number of worker threads, 0 for hardware concurrency
+	 * batch     - number of elements a worker takes at once
+	 */
+	array(const details::clas<T>& structure, unsigned threads = 0,
+			std::size_t batch = 32) noexcept
+	  : structure(structure),
+		workers(threads ? threads : std::thread::hardware_concurrency()),
+		batch(batch ? batch : 1) {
+		if( workers == 0 ) workers = 1;
+	}
+
+	/** parses array of size characters from data into out, replacing its
+	 *  content. returns true if all elements were bound successfully	*/
+	bool read(const char_t* data, std::size_t size, std::vector<T>& out)
+			noexcept {
+		std::atomic<std::size_t> malformed(0);
+		std::atomic<std::size_t> thefts(0);
+		bool ok = false;
+		failures = steals = 0;
+		__try {
+			std::vector<range> elements;
+			if( ! scan(data, size, elements) ) return false;
+			out.clear();
+			out.resize(elements.size());
+			unsigned n = workers;
+			if( n > elements.size() / batch ) n = elements.size() / batch;
+			if( n == 0 ) n = 1;
+			std::unique_ptr<slice[]> slices(new slice[n]);
+			for(unsigned i = 0; i < n; ++i) {
+				slices[i].lo = elements.size() * i / n;
+				slices[i].hi = elements.size() * (i + 1) / n;
+			}
+			auto work = [&](unsigned self) noexcept {
+				std::size_t lo = 0, hi = 0;
+				for(;;) {
+					if( ! take(slices[self], lo, hi) ) {
+						if( steal(slices.get(), n, self, thefts) ) continue;
+						break;
+					}
+					for(; lo < hi; ++lo)
+						if( ! parse(elements[lo], out[lo]) ) ++malformed;
+				}
+			};
+			/* slices of workers not started are stolen by the others */
+			team crew;
+			crew.start(n, work);
+			work(0);
+			crew.join();
+			ok = true;
+		} __catch(...) {
+			ok = false;
+		}
+		failures = malformed;
+		steals = thefts;
+		return ok && failures == 0;
+	}
+
+	/** number of malformed elements in the last read */
+	inline std::size_t failed() const noexcept { return failures; }
+	/** number of successful steals in the last read */
+	inline std::size_t stolen() const noexcept { return steals; }
+	/** number of worker threads */
+	inline unsigned threads() const noexcept { return workers; }
+private:
+	struct range {
+		const char_t* data;
+		std::size_t size;
+	};
+	/* remaining elements of a worker, guarded by its own mutex */
+	struct slice {
+		std::mutex mutex;
+		std::size_t lo = 0;
+		std::size_t hi = 0;
+	};
+
+	static inline bool isspace(char_t c) noexcept {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	/* locates top-level elements of an array, returns false if the text
+	 * is not a well-formed array at the structural level */
+	static bool scan(const char_t* data, std::size_t size,
+			std::vector<range>& elements) {
+		using details::literal;
+		const char_t* p = data;
+		const char_t* const end = data + size;
+		while( p < end && isspace(*p) ) ++p;
+		if( p == end || *p++ != literal::begin_array ) return false;
+		const char_t* begin = p;
+		std::size_t depth = 0;
+		bool empty = true;
+		for(; p < end; ++p) {
+			switch( *p ) {
+			case literal::quotation_mark:
+				/* skip the string, honoring escapes */
+				for(++p; p < end && *p != literal::quotation_mark; ++p)
+					if( *p == literal::escape ) ++p;
+				if( p >= end ) return false;
+				empty = false;
+				break;
+			case literal::begin_array:
+			case literal::begin_object:
+				++depth;
+				empty = false;
+				break;
+			case literal::end_object:
+				if( depth-- == 0 ) return false;
+				break;
+			case literal::end_array:
+				if( depth-- != 0 ) break;
+				if( ! empty || ! elements.empty() ) {
+					if( empty ) return false; /* trailing comma */
+					elements.push_back(range{begin, std::size_t(p - begin)});
+				}
+				for(++p; p < end && isspace(*p); ++p);
+				return p == end;
+			case literal::value_separator:
+				if( depth != 0 ) break;
+				if( empty ) return false;
+				elements.push_back(range{begin, std::size_t(p - begin)});
+				begin = p + 1;
+				empty = true;
+				break;
+			default:
+				if( ! isspace(*p) ) empty = false;
+			}
+		}
+		return false;
+	}
+	/* takes a batch from own slice */
+	bool take(slice& s, std::size_t& lo, std::size_t& hi) const noexcept {
+		std::lock_guard<std::mutex> lock(s.mutex);
+		if( s.lo == s.hi ) return false;
+		lo = s.lo;
+		hi = s.hi - s.lo > batch ? s.lo + batch : s.hi;
+		s.lo = hi;
+		return true;
+	}
+
+	/* moves the upper half of the largest other slice into own slice */
+	bool steal(slice* slices, unsigned n, unsigned self,
+			std::atomic<std::size_t>& stolen) const noexcept {
+		unsigned victim = self;
+		std::size_t most = 0;
+		for(unsigned i = 0; i < n; ++i) {
+			if( i == self ) continue;
+			std::lock_guard<std::mutex> lock(slices[i].mutex);
+			if( slices[i].hi - slices[i].lo > most ) {
+				most = slices[i].hi - slices[i].lo;
+				victim = i;
+			}
+		}
+		if( victim == self ) return false;
+		std::size_t lo, hi;
+		{
+			std::lock_guard<std::mutex> lock(slices[victim].mutex);
+			std::size_t left = slices[victim].hi - slices[victim].lo;
+			if( left == 0 ) return true; /* drained meanwhile, look again */
+			lo = slices[victim].hi - (left + 1) / 2;
+			hi = slices[victim].hi;
+			slices[victim].hi = lo;
+		}
+		++stolen;
+		std::lock_guard<std::mutex> lock(slices[self].mutex);
+		slices[self].lo = lo;
+		slices[self].hi = hi;
+		return true;
+	}
+
+	bool parse(const range& r, T& dst) const noexcept {
+		/* the text is read only, in-situ views are not bound from it */
+		const wrapper::segment text[] = {
+			{ r.data, static_cast<cojson::size_t>(r.size) } };
+		wrapper::segments in(text);
+		details::lexer lex(in);
+		char_t c;
+		/* only whitespace may follow the element */
+		return structure.read(dst, lex) && ! lex.skipws(c) &&
+			lex.error() == details::error_t::noerror;
+	}
+
+	const details::clas<T>& structure;
+	unsigned workers;
+	std::size_t batch;
+	std::size_t failures = 0;
+	std::size_t steals = 0;
+};
+
+/**
+ * Growable output buffer, written by a single worker
+ */
+class block : public details::ostream {
+public:
+	bool put(char_t c) noexcept {
+		__try { text.push_back(c); } __catch(...) { return overrun(); }
+		return true;
+	}
+	bool write(const char_t* s, size_t n) noexcept {
+		__try { text.insert(text.end(), s, s + n); }
+		__catch(...) { return overrun(); }
+		return true;
+	}
+	inline const char_t* data() const noexcept { return text.data(); }
+	inline std::size_t size() const noexcept { return text.size(); }
+	inline void clear() noexcept {
+		text.clear();
+		details::ostream::clear();
+	}
+private:
+	bool overrun() noexcept {
+		details::ostream::error(details::error_t::overrun);
+		return false;
+	}
+	std::vector<char_t> text;
+};
+
+/** a part of scatter-gather output */
+struct part {
+	const char_t* data;
+	std::size_t size;
+};
+
+/**
+ * Scatter-gather sink, receives all parts of a document at once
+ */
+struct gather {
+	virtual bool write(const part* parts, std::size_t count) noexcept = 0;
+};
+
+/**
+ * Gather sink writing parts to an ostream one after another
+ */
+class forward : public gather {
+public:
+	inline forward(details::ostream& out) noexcept : out(out) {}
+	bool write(const part* parts, std::size_t count) noexcept {
+		for(std::size_t i = 0; i < count; ++i) {
+			const char_t* data = parts[i].data;
+			std::size_t size = parts[i].size;
+			/* ostream::write takes cojson::size_t */
+			while( size ) {
+				size_t n = size > limit ? limit : static_cast<size_t>(size);
+				if( ! out.write(data, n) ) return false;
+				data += n;
+				size -= n;
+			}
+		}
+		return true;
+	}
+private:
+	static constexpr std::size_t limit =
+		std::numeric_limits<cojson::size_t>::max();
+	details::ostream& out;
+};
+
+#if defined(__unix__)
+/**
+ * Gather sink writing parts to a file descriptor with writev
+ */
+class descriptor : public gather {
+public:
+	inline descriptor(int fd) noexcept : fd(fd), err(0) {}
+	bool write(const part* parts, std::size_t count) noexcept {
+		iovec iov[batch];
+		std::size_t done = 0;	/* bytes of parts[0] already written */
+		while( count ) {
+			int n = 0;
+			for(; n < batch && static_cast<std::size_t>(n) < count; ++n) {
+				iov[n].iov_base = const_cast<char_t*>(parts[n].data);
+				iov[n].iov_len  = parts[n].size * sizeof(char_t);
+			}
+			iov[0].iov_base = static_cast<char*>(iov[0].iov_base) + done;
+			iov[0].iov_len -= done;
+			ssize_t w = ::writev(fd, iov, n);
+			if( w < 0 ) {
+				if( errno == EINTR ) continue;
+				err = errno;
+				return false;
+			}
+			/* skip fully written parts, remember offset in the partial one */
+			std::size_t left = static_cast<std::size_t>(w) + done;
+			done = 0;
+			while( count && left >= parts->size * sizeof(char_t) ) {
+				left -= parts->size * sizeof(char_t);
+				++parts;
+				--count;
+			}
+			done = left;
+		}
+		return true;
+	}
+	/** errno of the last failure */
+	inline int error() const noexcept { return err; }
+private:
+	static constexpr int batch = IOV_MAX < 64 ? IOV_MAX : 64;
+	int fd;
+	int err;
+};
+#endif
+
+/**
+ * Serializes a large vector of objects on several threads.
+ * The vector is partitioned in contiguous ranges, one per worker, each
+ * range is written with clas<T> into the worker's own growable block.
+ * Blocks are then joined with separators into a single JSON array,
+ * handed to a gather sink as a list of parts without copying
+ * Usage:
+ *   parallel::writer<Device> devices(Device::structure());
+ *   parallel::descriptor sink(fd);
+ *   devices.write(list, sink);
+ */
+template<class T>
+class writer {
+public:
+	/**
+	 * structure - class descriptor for T
+	 * threads   - number of worker threads, 0 for hardware concurrency
+	 */
+	writer(const details::clas<T>& structure, unsigned threads = 0) noexcept
+	  : structure(structure),
+		workers(threads ? threads : std::thread::hardware_concurrency()) {
+		if( workers == 0 ) workers = 1;
+	}
+
+	/** writes objects as JSON array to a gather sink */
+	bool write(const std::vector<T>& objects, gather& out) noexcept {
+		using details::literal;
+		static constexpr char_t begin = literal::begin_array;
+		static constexpr char_t separator = literal::value_separator;
+		static constexpr char_t end = literal::end_array;
+		bool ok = false;
+		__try {
+			unsigned n = workers < objects.size() ? workers : objects.size();
+			while( blocks.size() < n ) blocks.emplace_back();
+			std::atomic<bool> good(true);
+			auto work = [&](unsigned self) noexcept {
+				block& dst = blocks[self];
+				dst.clear();
+				std::size_t lo = objects.size() * self / n;
+				std::size_t hi = objects.size() * (self + 1) / n;
+				for(std::size_t i = lo; i < hi; ++i)
+					if( (i != lo && ! dst.put(separator)) ||
+						! structure.write(objects[i], dst) ) {
+						good = false;
+						return;
+					}
+			};
+			team crew;
+			unsigned started = n ? crew.start(n, work) : 0;
+			if( n ) work(0);
+			/* ranges of workers not started are written here */
+			for(unsigned i = started; i < n; ++i) work(i);
+			crew.join();
+			if( ! good ) return false;
+			std::vector<part> parts;
+			parts.reserve(2 * n + 1);
+			parts.push_back(part{&begin, 1});
+			for(unsigned i = 0; i < n; ++i) {
+				if( i ) parts.push_back(part{&separator, 1});
+				parts.push_back(part{blocks[i].data(), blocks[i].size()});
+			}
+			parts.push_back(part{&end, 1});
+			ok = out.write(parts.data(), parts.size());
+		} __catch(...) {
+			ok = false;
+		}
+		return ok;
+	}
+
+	/** writes objects as JSON array to an ostream */
+	inline bool write(const std::vector<T>& objects, details::ostream& out)
+			noexcept {
+		forward sink(out);
+		return write(objects, sink);
+	}
+
+	/** number of worker threads */
+	inline unsigned threads() const noexcept { return workers; }
+private:
+	const details::clas<T>& structure;
+	unsigned workers;
+	/* kept between calls to reuse allocated memory */
+	std::deque<block> blocks;
+};
+
+}
+}
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_pointer.hpp - extraction of values addressed by JSON pointers
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <cojson.hpp>
+
+namespace cojson {
+
+/**
+ * RFC 6901 JSON pointer bound to a target variable.
+ * The path is validated once on construction, while matching
+ * the pointer keeps a cursor at the segment of the current level
+ */
+class Pointer {
+public:
+	/** binds path to a variable readable with details::reader<T> */
+	template<typename T>
+	Pointer(cstring path, T& dst) noexcept
+	  : path(path), target(&dst), bind(&bind_value<T>), size(0) {
+		compile();
+	}
+	/** binds path to a string buffer */
+	template<size_t N>
+	Pointer(cstring path, char_t (&dst)[N]) noexcept
+	  : path(path), target(dst), bind(&bind_string), size(N) {
+		compile();
+	}
+	/** true if the path is a well-formed JSON pointer */
+	inline bool valid() const noexcept { return depth != invalid; }
+	/** true if the value was found and bound by the last extraction */
+	inline bool found() const noexcept { return bound; }
+private:
+	friend class Extract;
+	static constexpr unsigned char invalid = 0xFF;
+
+	template<typename T>
+	static bool bind_value(void* dst, size_t, details::lexer& in) noexcept {
+		return details::reader<T>::read(*static_cast<T*>(dst), in);
+	}
+	static bool bind_string(void* dst, size_t n, details::lexer& in) noexcept {
+		return details::reader<char_t*>::read(static_cast<char_t*>(dst), n,
+			in);
+	}
+
+	/* validates escapes, counts segments */
+	void compile() noexcept {
+		unsigned n = 0;
+		depth = invalid;
+		if( *path && *path != separator ) return;
+		for(cstring p = path; *p; ++p) {
+			if( *p == separator ) {
+				if( ++n >= invalid ) return;
+			} else if( *p == tilde && p[1] != '0' && p[1] != '1' ) return;
+		}
+		depth = n;
+	}
+	/* true if both paths are the same or one leads into the other */
+	bool overlaps(const Pointer& that) const noexcept {
+		cstring p = path, q = that.path;
+		for(; *p && *p == *q; ++p, ++q);
+		return (*p == 0 && (*q == 0 || *q == separator)) ||
+			(*q == 0 && *p == separator);
+	}
+	/* moves cursor to the start of the first segment */
+	inline void reset() noexcept {
+		cursor = path;
+		bound = false;
+	}
+	/* true if the cursor is at the end of path */
+	inline bool end() const noexcept { return *cursor == 0; }
+	/* moves cursor to the next segment */
+	inline void down() noexcept {
+		for(++cursor; *cursor && *cursor != separator; ++cursor);
+	}
+	/* moves cursor back to the previous segment */
+	inline void up() noexcept {
+		while( --cursor != path && *cursor != separator );
+	}
+	/* matches segment at the cursor with a member name */
+	bool match(const char_t* name) const noexcept {
+		cstring p = cursor + 1;
+		for(; *p && *p != separator; ++p, ++name) {
+			char_t c = *p;
+			if( c == tilde ) c = *++p == '0' ? tilde : separator;
+			if( c != *name ) return false;
+		}
+		return *name == 0;
+	}
+	/* matches segment at the cursor with an array index */
+	bool match(size_t index) const noexcept {
+		cstring p = cursor + 1;
+		size_t value = 0;
+		if( *p == '0' && p[1] && p[1] != separator ) return false;
+		if( ! *p || *p == separator ) return false;
+		for(; *p && *p != separator; ++p) {
+			if( *p < '0' || *p > '9' ) return false;
+			size_t next = value * 10 + (*p - '0');
+			if( next / 10 != value ) return false;	/* overflow */
+			value = next;
+		}
+		return value == index;
+	}
+
+	static constexpr char_t separator = '/';
+	static constexpr char_t tilde = '~';
+	cstring path;
+	void* target;
+	bool (*bind)(void*, size_t, details::lexer&) noexcept;
+	size_t size;
+	cstring cursor = nullptr;
+	unsigned char depth = invalid;
+	bool bound = false;
+};
+
+/**
+ * Extracts values addressed by JSON pointers in a single pass.
+ * Subtrees not leading to any pointer are skipped, the input is read
+ * only until all pointers are resolved.
+ * Usage:
+ *   long quality; char_t ip[16];
+ *   Pointer pointers[] = {
+ *     { "/wan/ipaddr/2", ip },
+ *     { "/wifinets/0/networks/0/quality", quality }
+ *   };
+ *   Extract(pointers).read(input);
+ */
+class Extract {
+public:
+	typedef uint_fast32_t mask_t;
+	static constexpr unsigned max = sizeof(mask_t) * 8;
+
+	Extract(Pointer* pointers, unsigned count) noexcept
+	  : pointers(pointers), count(count), disjoint(true) {
+		/* a value is read once, it can't be bound by two pointers,
+		 * nor bound as a whole and walked into for another one	*/
+		for(unsigned i = 1; i < count && disjoint; ++i)
+			for(unsigned j = 0; j < i && disjoint; ++j)
+				disjoint = ! pointers[i].overlaps(pointers[j]);
+	}
+	template<unsigned N>
+	Extract(Pointer (&pointers)[N]) noexcept : Extract(pointers, N) {
+		static_assert(N <= max, "Too many pointers");
+	}
+
+	/** true if pointers are not too many and none is given twice
+	 *  or leads into a value addressed by another one				*/
+	inline bool valid() const noexcept { return count <= max && disjoint; }
+	/** reads input until all pointers are resolved or input ends,
+	 *  returns true if all pointers were found and bound			*/
+	bool read(details::lexer& in) noexcept {
+		if( ! valid() ) return false;
+		mask_t all = 0;
+		for(unsigned i = 0; i < count; ++i) {
+			if( ! pointers[i].valid() ) return false;
+			pointers[i].reset();
+			all |= mask_t(1) << i;
+		}
+		pending = all;
+		return walk(in, all) && pending == 0;
+	}
+	bool read(details::istream& in) noexcept {
+		details::lexer lex(in);
+		return read(lex);
+	}
+	/** number of pointers resolved by the last read */
+	unsigned found() const noexcept {
+		unsigned n = 0;
+		for(unsigned i = 0; i < count; ++i) n += pointers[i].found();
+		return n;
+	}
+private:
+	/* processes a value, set holds pointers matching the current path */
+	bool walk(details::lexer& in, mask_t set) noexcept {
+		using namespace details;
+		if( set == 0 ) return in.skip();
+		for(unsigned i = 0; i < count; ++i) {
+			if( (set & (mask_t(1) << i)) && pointers[i].end() ) {
+				Pointer& p = pointers[i];
+				pending &= ~(mask_t(1) << i);
+				if( (p.bound = p.bind(p.target, p.size, in)) ) return true;
+				/* a mismatching value is skipped as in collection::read */
+				return in.skip();
+			}
+		}
+		char_t chr;
+		if( ! in.skipws(chr) ) return false;
+		switch( chr ) {
+		case literal::begin_object:
+			return object(in, set);
+		case literal::begin_array:
+			return array(in, set);
+		default:
+			/* pointers lead into a scalar, not found */
+			in.back(chr);
+			return in.skip();
+		}
+	}
+
+	/* matching subset of set for a member name or an array index */
+	template<typename K>
+	mask_t select(mask_t set, K key) noexcept {
+		mask_t sub = 0;
+		for(unsigned i = 0; i < count; ++i)
+			if( (set & (mask_t(1) << i)) && pointers[i].match(key) )
+				sub |= mask_t(1) << i;
+		return sub;
+	}
+	/* descends matching pointers into a nested value */
+	bool nested(details::lexer& in, mask_t sub) noexcept {
+		for(unsigned i = 0; i < count; ++i)
+			if( sub & (mask_t(1) << i) ) pointers[i].down();
+		bool r = walk(in, sub);
+		for(unsigned i = 0; i < count; ++i)
+			if( sub & (mask_t(1) << i) ) pointers[i].up();
+		return r;
+	}
+
+	bool object(details::lexer& in, mask_t set) noexcept {
+		using namespace details;
+		char_t chr;
+		if( ! in.skipws(chr) ) return false;
+		if( chr == literal::end_object ) return true;
+		in.back(chr);
+		do {
+			char_t* name;
+			if( ! in.member(name) ) return false;
+			if( ! nested(in, select(set, name)) ) return false;
+			if( pending == 0 ) return true;
+			if( ! in.skipws(chr) ) return false;
+		} while( chr == literal::value_separator );
+		if( chr == literal::end_object ) return true;
+		in.error(error_t::bad);
+		return false;
+	}
+
+	bool array(details::lexer& in, mask_t set) noexcept {
+		using namespace details;
+		char_t chr;
+		if( ! in.skipws(chr) ) return false;
+		if( chr == literal::end_array ) return true;
+		in.back(chr);
+		size_t index = 0;
+		do {
+			if( ! nested(in, select(set, index++)) ) return false;
+			if( pending == 0 ) return true;
+			if( ! in.skipws(chr) ) return false;
+		} while( chr == literal::value_separator );
+		if( chr == literal::end_array ) return true;
+		in.error(error_t::bad);
+		return false;
+	}
+
+	Pointer* pointers;
+	unsigned count;
+	bool disjoint;
+	mask_t pending = 0;
+};
+
+}
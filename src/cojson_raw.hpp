@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_raw.hpp - numbers, strings and values kept as their text
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <cojson.hpp>
+
+namespace cojson {
+
+/**
+ * A number kept as its lexeme of up to N characters. It is converted
+ * on the first access, the result is cached. Written back, the lexeme
+ * is emitted as it was read, without a conversion round trip.
+ * Usage:
+ *   struct Reading { RawNumber<> value; ... };
+ *   P<Reading, Name::value, RawNumber<>, &Reading::value>
+ */
+template<size_t N = 32>
+class RawNumber {
+public:
+	inline RawNumber() noexcept
+	  : len(0), dbl(0), lng(0), cached(none) { text[0] = 0; }
+	/** the lexeme, empty if the value was null						*/
+	inline const char_t* lexeme() const noexcept { return text; }
+	inline size_t size() const noexcept { return len; }
+	inline bool empty() const noexcept { return len == 0; }
+
+	/** value as a double, converted once */
+	double number() const noexcept {
+		if( ! (cached & floating) ) {
+			dbl = 0;
+			if( len ) convert(dbl);
+			cached |= floating;
+		}
+		return dbl;
+	}
+	/** value as an integer, fractions are truncated, converted once */
+	long long integer() const noexcept {
+		if( ! (cached & integral) ) {
+			lng = 0;
+			if( len && ! convert(lng) ) lng = static_cast<long long>(number());
+			cached |= integral;
+		}
+		return lng;
+	}
+
+	bool read(details::lexer& in) noexcept {
+		using namespace details;
+		len = 0;
+		text[0] = 0;
+		cached = none;
+		ctype ct;
+		if( ! isvalid(ct = in.value(ctype::number | ctype::null)) )
+			return in.skip();
+		if( ct == ctype::null ) {
+			if( ! config::null_is_error ) return true;
+			in.error(error_t::mismatch);
+			return false;
+		}
+		char_t chr;
+		while( hasbits(ct = in.get(chr, ctype::number), ctype::number) ) {
+			if( len == N ) {
+				text[0] = len = 0;
+				in.error(error_t::overrun);
+				return in.skip(ctype::number);
+			}
+			text[len++] = chr;
+		}
+		text[len] = 0;
+		if( ct == ctype::unknown ) {
+			in.back(chr);
+			return true;
+		}
+		return ct == ctype::eof;
+	}
+	bool write(details::ostream& out) const noexcept {
+		return len ? out.write(text, len) : details::value::null(out);
+	}
+private:
+	/* converts the lexeme with the regular reader */
+	template<typename T>
+	bool convert(T& val) const noexcept {
+		wrapper::buffer buf(const_cast<char_t*>(text), len);
+		details::lexer lex(buf);
+		return details::reader<T>::read(val, lex);
+	}
+	/* conversions cached, each kind on its own */
+	enum kind : unsigned char { none = 0, floating = 1, integral = 2 };
+	char_t text[N + 1];
+	size_t len;
+	mutable double dbl;
+	mutable long long lng;
+	mutable unsigned char cached;
+};
+
+/**
+ * A string kept as its lexeme of up to N characters, quotation marks
+ * and escapes included. The lexeme is not validated while reading,
+ * it is decoded on request. Written back, the lexeme is emitted as it
+ * was read.
+ * Usage:
+ *   struct Message { RawString<64> body; ... };
+ *   P<Message, Name::body, RawString<64>, &Message::body>
+ */
+template<size_t N>
+class RawString {
+public:
+	inline RawString() noexcept : len(0) { text[0] = 0; }
+	/** the lexeme with quotation marks, empty if the value was null	*/
+	inline const char_t* lexeme() const noexcept { return text; }
+	inline size_t size() const noexcept { return len; }
+	inline bool empty() const noexcept { return len == 0; }
+
+	/** decodes the string into dst of n characters */
+	bool decode(char_t* dst, size_t n) const noexcept {
+		if( len == 0 || n == 0 ) return false;
+		wrapper::buffer buf(const_cast<char_t*>(text), len);
+		details::lexer lex(buf);
+		return details::reader<char_t*>::read(dst, n, lex);
+	}
+	template<size_t M>
+	inline bool decode(char_t (&dst)[M]) const noexcept {
+		return decode(dst, M);
+	}
+
+	bool read(details::lexer& in) noexcept {
+		using namespace details;
+		len = 0;
+		text[0] = 0;
+		ctype ct;
+		if( ! isvalid(ct = in.value(ctype::stringnull)) ) return in.skip();
+		if( ct == ctype::null ) {
+			if( ! config::null_is_error ) return true;
+			in.error(error_t::mismatch);
+			return false;
+		}
+		char_t chr;
+		in.skipws(chr);	/* the quotation mark held by value */
+		text[len++] = chr;
+		bool escaped = false;
+		for(;;) {
+			if( ! isvalid(in.get(chr, ctype::string)) ) {
+				text[0] = len = 0;
+				in.bad(chr);
+				return false;
+			}
+			if( len == N ) {
+				text[0] = len = 0;
+				in.error(error_t::overrun);
+				if( ! escaped && chr == literal::quotation_mark ) return true;
+				/* an escape must be consumed whole before skipping */
+				if( ! escaped && chr == literal::escape &&
+					! isvalid(in.get(chr, ctype::string)) ) {
+					in.bad(chr);
+					return false;
+				}
+				return in.skip_string(false);
+			}
+			text[len++] = chr;
+			if( escaped ) escaped = false;
+			else if( chr == literal::escape ) escaped = true;
+			else if( chr == literal::quotation_mark ) break;
+		}
+		text[len] = 0;
+		return true;
+	}
+	bool write(details::ostream& out) const noexcept {
+		return len ? out.write(text, len) : details::value::null(out);
+	}
+private:
+	char_t text[N + 1];
+	size_t len;
+};
+
+/**
+ * Any JSON value, object, array or scalar, captured as its text of up to
+ * N characters. The value is skipped with the fast skipper, characters
+ * passed over are copied. Written back, the text is emitted verbatim.
+ * A value longer than N is skipped, leaving RawJson empty with overrun.
+ * Usage:
+ *   struct Envelope { RawJson<512> payload; ... };
+ *   P<Envelope, Name::payload, RawJson<512>, &Envelope::payload>
+ */
+template<size_t N>
+class RawJson {
+public:
+	inline RawJson() noexcept : len(0) { text[0] = 0; }
+	/** the captured text, empty if nothing was captured				*/
+	inline const char_t* data() const noexcept { return text; }
+	inline size_t size() const noexcept { return len; }
+	inline bool empty() const noexcept { return len == 0; }
+
+	bool read(details::lexer& in) noexcept {
+		wrapper::buffer dst(text, N);
+		bool r = in.copy(dst);
+		bool fit = dst.error() == details::error_t::noerror;
+		len = fit ? dst.count() : 0;
+		text[len] = 0;
+		if( r && ! fit ) in.error(details::error_t::overrun);
+		return r;
+	}
+	bool write(details::ostream& out) const noexcept {
+		return len ? out.write(text, len) : details::value::null(out);
+	}
+private:
+	char_t text[N + 1];
+	size_t len;
+};
+
+/**
+ * An object of type T with structure S, captured as RawJson<N> and bound
+ * to T only on the first access. Until T is modified via edit(), writing
+ * emits the captured text verbatim, afterwards T is written with S.
+ * Binding leaves the captured text intact, so T may not have in-situ views.
+ * Usage:
+ *   struct Envelope { Lazy<Payload, Payload::structure> payload; ... };
+ *   P<Envelope, Name::payload, Lazy<Payload, Payload::structure>,
+ *   	&Envelope::payload>
+ */
+template<class T, const details::clas<T>& S(), size_t N = 256>
+class Lazy {
+public:
+	inline Lazy() noexcept : obj(), state(unbound) {}
+	/** binds the captured text once, returns true on success */
+	bool bind() const noexcept {
+		if( state == unbound ) {
+			obj = T();
+			/* the captured text stays intact, it is not contiguous input */
+			const wrapper::segment text[] = { { json.data(), json.size() } };
+			wrapper::segments buf(text);
+			details::lexer lex(buf);
+			state = ! json.empty() && S().read(obj, lex) ? bound : failed;
+		}
+		return state != failed;
+	}
+	inline const T& get() const noexcept { bind(); return obj; }
+	inline const T& operator*() const noexcept { return get(); }
+	inline const T* operator->() const noexcept { return &get(); }
+	/** gives a mutable T, the captured text is no longer written */
+	inline T& edit() noexcept {
+		bind();
+		state = edited;
+		return obj;
+	}
+	inline const RawJson<N>& raw() const noexcept { return json; }
+
+	bool read(details::lexer& in) noexcept {
+		state = unbound;
+		return json.read(in);
+	}
+	bool write(details::ostream& out) const noexcept {
+		return state == edited ? S().write(obj, out) : json.write(out);
+	}
+private:
+	enum state_t : unsigned char { unbound, bound, failed, edited };
+	RawJson<N> json;
+	mutable T obj;
+	mutable state_t state;
+};
+
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_ring.hpp - single-producer/single-consumer ring buffer streams
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cojson.hpp>
+
+namespace cojson {
+namespace wrapper {
+
+/**
+ * Wait policies for the ring buffer. A policy implements
+ * await(ready) - returns when ready() yields true
+ * notify()     - called by the other side after it has made progress
+ */
+namespace waiting {
+
+/** busy waiting, lowest latency, needs a dedicated core per side */
+struct spin {
+	template<class Ready>
+	inline void await(Ready ready) noexcept {
+		while( ! ready() ) pause();
+	}
+	inline void notify() noexcept {}
+	static inline void pause() noexcept {
+#	if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#	endif
+	}
+};
+
+/** yields the rest of the time slice while waiting */
+struct yield {
+	template<class Ready>
+	inline void await(Ready ready) noexcept {
+		while( ! ready() ) std::this_thread::yield();
+	}
+	inline void notify() noexcept {}
+};
+
+/** spins for a while and then blocks on a condition variable,
+ *  notify is a single fence and load while no one is blocked */
+class block {
+public:
+	inline block() noexcept : waiters(0) {}
+	template<class Ready>
+	void await(Ready ready) noexcept {
+		for(unsigned n = 0; n < spins; ++n)
+			if( ready() ) return;
+			else spin::pause();
+		waiters.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		__try {
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, ready);
+		} __catch(...) {
+			while( ! ready() ) std::this_thread::yield();
+		}
+		waiters.fetch_sub(1);
+	}
+	inline void notify() noexcept {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if( waiters.load(std::memory_order_relaxed) == 0 ) return;
+		__try {
+			std::lock_guard<std::mutex> lock(mutex);
+			condition.notify_all();
+		} __catch(...) {}
+	}
+private:
+	static constexpr unsigned spins = 256;
+	std::atomic<unsigned> waiters;
+	std::mutex mutex;
+	std::condition_variable condition;
+};
+}
+
+/**
+ * Wait-free single-producer/single-consumer ring buffer of N characters.
+ * The producer writes via output(), the consumer reads via input().
+ * Each side waits with policy W only when the ring is full or empty.
+ * Progress is published to the other side in batches of a quarter ring,
+ * by every write(), advance(), flush() and close(), and before waiting.
+ * A producer pausing between messages calls flush() to hand them over.
+ * N must be a power of two
+ */
+template<size_t N, class W = waiting::yield>
+class ring {
+	static_assert(N != 0 && (N & (N - 1)) == 0, "N must be a power of two");
+	static constexpr size_t mask = N - 1;
+	static constexpr size_t cacheline = 64;
+	static constexpr size_t batch = N < 4 ? 1 : N / 4;
+public:
+	inline ring() noexcept : head(0), tail(0), eos(false), abandoned(false) {}
+
+	/**
+	 * Consumer side of the ring
+	 */
+	class reader : public details::istream {
+	public:
+		bool get(char_t& val) noexcept {
+			using namespace details;
+			if( pos == limit && ! fill() ) {
+				val = iostate::eos_c;
+				istream::error(error_t::eof);
+				return false;
+			}
+			val = that.data[pos++ & mask];
+			if( pos - published >= batch ) publish();
+			return true;
+		}
+		/* window spans available characters up to the end of the ring */
+		const char_t* window(size_t& n) noexcept {
+			if( pos == limit && ! fill() ) {
+				n = 0;
+				return nullptr;
+			}
+			size_t end = N - (pos & mask);
+			n = limit - pos < end ? limit - pos : end;
+			return that.data + (pos & mask);
+		}
+		bool windowed() const noexcept {
+			return true;
+		}
+		void advance(size_t n) noexcept {
+			pos += n;
+			publish();
+		}
+		/** tells the producer no more data will be consumed */
+		inline void close() noexcept {
+			that.abandoned.store(true, std::memory_order_release);
+			that.wait.notify();
+		}
+	private:
+		friend class ring;
+		inline reader(ring& r) noexcept
+		  : that(r), pos(0), limit(0), published(0) {}
+		inline void publish() noexcept {
+			published = pos;
+			that.tail.store(pos, std::memory_order_release);
+			that.wait.notify();
+		}
+		bool fill() noexcept {
+			limit = that.head.load(std::memory_order_acquire);
+			if( limit != pos ) return true;
+			if( published != pos ) publish();
+			that.wait.await([this]() noexcept {
+				return that.head.load(std::memory_order_acquire) != pos
+					|| that.eos.load(std::memory_order_acquire);
+			});
+			limit = that.head.load(std::memory_order_acquire);
+			return limit != pos;
+		}
+		ring& that;
+		size_t pos;   /* local copy of tail 					*/
+		size_t limit; /* cached head 							*/
+		size_t published; /* tail last stored				*/
+	};
+
+	/**
+	 * Producer side of the ring
+	 */
+	class writer : public details::ostream {
+	public:
+		bool put(char_t val) noexcept {
+			using namespace details;
+			if( pos - limit == N && ! drain() ) {
+				ostream::error(error_t::eof);
+				return false;
+			}
+			that.data[pos++ & mask] = val;
+			if( pos - published >= batch ) publish();
+			return true;
+		}
+		/* copies runs up to the end of the ring, publishes once */
+		bool write(const char_t* s, size_t n) noexcept {
+			using namespace details;
+			while( n ) {
+				if( pos - limit == N && ! drain() ) {
+					ostream::error(error_t::eof);
+					return false;
+				}
+				size_t len = N - (pos - limit);
+				size_t end = N - (pos & mask);
+				if( len > end ) len = end;
+				if( len > n ) len = n;
+				char_t* dst = that.data + (pos & mask);
+				for(size_t i = 0; i < len; ++i) dst[i] = s[i];
+				pos += len;
+				s += len;
+				n -= len;
+			}
+			publish();
+			return true;
+		}
+		/** makes all characters written visible to the consumer */
+		inline void flush() noexcept {
+			if( published != pos ) publish();
+		}
+		/** tells the consumer no more data will be produced */
+		inline void close() noexcept {
+			flush();
+			that.eos.store(true, std::memory_order_release);
+			that.wait.notify();
+		}
+	private:
+		friend class ring;
+		inline writer(ring& r) noexcept
+		  : that(r), pos(0), limit(0), published(0) {}
+		inline void publish() noexcept {
+			published = pos;
+			that.head.store(pos, std::memory_order_release);
+			that.wait.notify();
+		}
+		bool drain() noexcept {
+			limit = that.tail.load(std::memory_order_acquire);
+			if( pos - limit != N ) return true;
+			flush();
+			that.wait.await([this]() noexcept {
+				return pos - that.tail.load(std::memory_order_acquire) != N
+					|| that.abandoned.load(std::memory_order_acquire);
+			});
+			limit = that.tail.load(std::memory_order_acquire);
+			return pos - limit != N;
+		}
+		ring& that;
+		size_t pos;   /* local copy of head 					*/
+		size_t limit; /* cached tail 							*/
+		size_t published; /* head last stored				*/
+	};
+
+	/** returns consumer side of the ring, to be used by a single thread */
+	inline reader& input() noexcept { return in; }
+	/** returns producer side of the ring, to be used by a single thread */
+	inline writer& output() noexcept { return out; }
+private:
+	alignas(cacheline) std::atomic<size_t> head;
+	alignas(cacheline) std::atomic<size_t> tail;
+	alignas(cacheline) std::atomic<bool> eos;
+	std::atomic<bool> abandoned;
+	W wait;
+	alignas(cacheline) reader in { *this };
+	alignas(cacheline) writer out { *this };
+	alignas(cacheline) char_t data[N];
+};
+
+}
+}
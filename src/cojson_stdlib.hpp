@@ -21,6 +21,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <vector>
 #if __cplusplus >= 201703L && (!defined(__GNUC__) || __GNUC__ >= 7)
@@ -29,6 +30,12 @@
 #else
 #	include <cojson.hpp>
 #endif
+#if __cplusplus >= 201703L && defined(__has_include)
+#	if __has_include(<memory_resource>)
+#		include <memory_resource>
+#		define WITH_COJSON_PMR
+#	endif
+#endif
 
 namespace cojson {
 
@@ -54,7 +61,13 @@ struct stdvector {
 	static inline const T get(size_t i) noexcept { return (*V)[i]; }
 	static T& lref(size_t) noexcept;
 	static inline const T& rref(size_t i) noexcept { return (*V)[i]; }
-	static inline void set(size_t i, const T & v) noexcept { __try { V->resize(i+1,v); } __catch(...) {} }
+	static inline void set(size_t i, const T & v) noexcept {
+		__try {
+			if( i < V->size() ) (*V)[i] = v;
+			else if( i == V->size() ) V->push_back(v);
+			else V->resize(i+1,v);
+		} __catch(...) {}
+	}
 	static inline void init(T&) noexcept {}
 	static inline constexpr bool null(void_t) noexcept {
 		return not config::null_is_error;
@@ -72,20 +85,27 @@ template<class String>
 bool read_string(String& dst, lexer& in) throw()  {
 	ctype ct;
 	bool first = true;
-	typename String::value_type chr;
-	dst.clear();
+	char_t chr;
+	dst.clear();	/* capacity is kept for the next read */
 	while( hasbits((ct=in.string(chr, first)), ctype::string | ctype::hex) ) {
 		dst.push_back(chr);
 		first = false;
 		if( hasbits(ct, ctype::hex) ) {
 			dst.push_back(in.hexremainder());
 		}
+		/* append plain characters in bulk, a string without escapes
+		 * is sized once from the length of its run					*/
+		size_t len = ~size_t(0);
+		const char_t* run = in.run(len);
+		if( run != nullptr && len != 0 ) {
+			dst.append(run, run + len);
+			in.consume(len);
+		}
 	}
-	dst.push_back(0);
 	if( ct == ctype::eof || ct == ctype::null ) {
 		return ct == ctype::eof || ! config::null_is_error;
 	}
-	return true;
+	return ct == ctype::delim;
 }
 
 
@@ -104,6 +124,32 @@ struct writer<std::string> {
 		return writer<const char_type *>::write(str.c_str(), out);
 	}
 };
+
+/* a string is emptied, its buffer is kept */
+template<class Ch, class Tr, class A>
+struct resetter<std::basic_string<Ch, Tr, A>> {
+	static inline void reset(std::basic_string<Ch, Tr, A>& str) noexcept {
+		str.clear();
+	}
+};
+#endif
+
+#ifdef WITH_COJSON_PMR
+template<>
+struct reader<std::pmr::string> {
+	static inline bool read(std::pmr::string& dst, lexer& in) noexcept {
+		__try { return read_string(dst, in); } __catch(...) { return false; }
+	}
+};
+
+template<>
+struct writer<std::pmr::string> {
+	static inline bool write(const std::pmr::string& str, ostream& out)
+			noexcept {
+		using char_type = typename std::pmr::string::value_type;
+		return writer<const char_type *>::write(str.c_str(), out);
+	}
+};
 #endif
 
 /**
@@ -182,68 +228,198 @@ const details::property<C> & PropertyStdString() noexcept {
 		bool write(const C& obj, details::ostream& out) const noexcept {
 			return details::writer<String>::write(obj.*M, out);
 		}
+		bool reset(C& obj) const noexcept {
+			(obj.*M).clear();
+			return true;
+		}
 	} l;
 	return l;
 }
 
-template<class C, details::name id, class Vector, Vector C::*M>
+/**
+ * std::vector being read: elements are reused in place or emplaced at
+ * the end, those left over are erased when done, capacity is kept.
+ * The size hint, learned by a property from previous reads, reserves
+ * capacity ahead of the first element of a vector that has none.
+ * The hint follows recent lists: it grows up to a list read, but no
+ * further than most items, and decays towards shorter lists
+ */
+template<class Vector>
+struct stdvector_cursor {
+	using T = typename Vector::value_type;
+	/* learned hints reserve no more than 64K at once */
+	static constexpr size_t most = sizeof(T) < (64 << 10) ?
+		(64 << 10) / sizeof(T) : 1;
+	inline stdvector_cursor(Vector& v, std::atomic<size_t>& h,
+		details::lexer& in) noexcept
+	  : vec(v), hint(h), seen(in.tracking()), count(0) {
+		size_t n = hint.load(std::memory_order_relaxed);
+		if( vec.capacity() == 0 && n != 0 ) {
+			__try { vec.reserve(n); } __catch(...) {}
+		}
+	}
+	/** element i, reused or emplaced, nullptr if out of memory */
+	inline T* at(size_t i) noexcept {
+		if( i == vec.size() ) {
+			const T* from = vec.data();
+			__try { vec.emplace_back(); } __catch(...) { return nullptr; }
+			/* objects recorded as seen moved with the storage */
+			if( seen != nullptr && from != nullptr && from != vec.data() )
+				seen->moved(from, i * sizeof(T), vec.data());
+		}
+		count = i + 1;
+		return &vec[i];
+	}
+	inline bool reused(size_t i) const noexcept { return i < vec.size(); }
+	inline void done() noexcept {
+		vec.erase(vec.begin() + count, vec.end());
+		size_t n = hint.load(std::memory_order_relaxed);
+		if( count > n ) {
+			if( n < most ) hint.store(count < most ? count : most,
+				std::memory_order_relaxed);
+		} else if( count < n ) {
+			hint.store(n - (n - count + 3) / 4, std::memory_order_relaxed);
+		}
+	}
+	static inline constexpr bool null(stdvector_cursor&) noexcept {
+		return false; /* not possible to nullify */
+	}
+private:
+	Vector& vec;
+	std::atomic<size_t>& hint;
+	details::presence* const seen;
+	size_t count;
+};
+
+/** PropertyStdVector
+ * nested in C std::vector of scalars or strings,
+ * Hint is the initial size hint
+ */
+template<class C, details::name id, class Vector, Vector C::*M,
+	size_t Hint = 0>
 inline const details::property<C>&  PropertyStdVector() noexcept {
 	static_assert(M != nullptr, "M must not be null");
-	//static const details::vector<accessor::stdvector<Vector,V>> l;
 	static const struct local : details::property<C> {
 		using T = typename Vector::value_type;
+		using cursor = stdvector_cursor<Vector>;
 		cstring name() const noexcept { return id(); }
 		bool read(C& obj, details::lexer& in) const noexcept {
-			(obj.*M).clear();
-			return details::collection<>::read(*this, obj, in);
+			cursor dst(obj.*M, hint, in);
+			bool r = details::collection<>::read(*this, dst, in);
+			dst.done();
+			return r;
 		}
 		bool write(const C& obj, details::ostream& out) const noexcept {
 			/* delegate write to array */
 			return details::array::write(*this, obj, out);
 		}
-		/** read item */
-		inline bool read(C& obj, details::lexer& in, size_t i) const noexcept {
-			__try { (obj.*M).resize(i+1); } __catch(...) { return false; }
-			return
-				details::reader<T>::read((obj.*M)[i], in) || in.skip(false);
+		bool reset(C& obj) const noexcept {
+			(obj.*M).clear();
+			return true;
+		}
+		static inline constexpr bool null(cursor& dst) noexcept {
+			return cursor::null(dst);
+		}
+		/** read item in place */
+		inline bool read(cursor& dst, details::lexer& in, size_t i)
+				const noexcept {
+			T* item = dst.at(i);
+			if( item == nullptr ) return false;
+			if( details::reader<T>::read(*item, in) ) return true;
+			*item = T();
+			return in.skip(false);
 		}
 		/** write item item */
 		inline bool write(const C& obj, details::ostream& out, size_t i) const noexcept {
 			return i < (obj.*M).size() && details::writer<T>::write((obj.*M)[i], out) && (i+1) < (obj.*M).size();
 		}
+		mutable std::atomic<size_t> hint { Hint };
 	} l;
 	return l;
 }
 
 /** PropertyArrayOfObjects
- * nested in C array of objects of type T with structure S
+ * nested in C array of objects of type T with structure S,
+ * Hint is the initial size hint
  */
 template<class C, details::name id, class Vector, Vector C::*M,
-	const details::clas<typename Vector::value_type>& S()>
+	const details::clas<typename Vector::value_type>& S(), size_t Hint = 0>
 inline const details::property<C> & PropertyStdVector() {
 	static const struct local : details::property<C> {
+		using T = typename Vector::value_type;
+		using cursor = stdvector_cursor<Vector>;
 		cstring name() const noexcept { return id(); }
 		bool read(C& obj, details::lexer& in) const noexcept {
-			return details::collection<>::read(*this, obj, in);
+			cursor dst(obj.*M, hint, in);
+			bool r = details::collection<>::read(*this, dst, in);
+			dst.done();
+			return r;
 		}
 		bool write(const C& obj, details::ostream& out) const noexcept {
 			return details::array::write(*this, obj, out);
 		}
-		/** read item */
-		inline bool read(C& obj, details::lexer& in, size_t i) const noexcept {
-			__try { (obj.*M).resize(i+1); } __catch(...) { return false; }
-			return S().read((obj.*M)[i], in);
+		bool reset(C& obj) const noexcept {
+			(obj.*M).clear();
+			return true;
+		}
+		static inline constexpr bool null(cursor& dst) noexcept {
+			return cursor::null(dst);
+		}
+		/** read item in place, a reused item is reset first, keeping
+		 *  storage of its members where they can be reset in place */
+		inline bool read(cursor& dst, details::lexer& in, size_t i)
+				const noexcept {
+			bool reused = dst.reused(i);
+			T* item = dst.at(i);
+			if( item == nullptr ) return false;
+			if( reused && ! S().reset(*item) ) *item = T();
+			return S().read(*item, in);
 		}
 		/** write item item */
 		inline bool write(const C& obj, details::ostream& out,
 				size_t i) const noexcept {
 			return i < (obj.*M).size() && S().write((obj.*M)[i], out) && (i+1) < (obj.*M).size();
 		}
+		mutable std::atomic<size_t> hint { Hint };
 	} l;
 	return l;
 }
 }
 
+#ifdef WITH_COJSON_PMR
+namespace pmr {
+/**
+ * Parse context carrying a monotonic arena for std::pmr members.
+ * Strings and vectors constructed with its allocator take memory from
+ * N bytes of inline storage, then from upstream in growing blocks.
+ * Nothing is freed until the context is released or destroyed, so
+ * objects using the context must not outlive it.
+ * Usage:
+ *   pmr::context<4096> ctx;
+ *   Doc doc(ctx.allocator());	// std::pmr::string, std::pmr::vector members
+ *   Doc::structure().read(doc, in);
+ */
+template<size_t N = 4096>
+class context {
+public:
+	inline explicit context(std::pmr::memory_resource* upstream =
+		std::pmr::get_default_resource()) noexcept
+	  : arena(storage, N, upstream) {}
+	context(const context&) = delete;
+	context& operator=(const context&) = delete;
+	inline std::pmr::memory_resource* resource() noexcept { return &arena; }
+	inline std::pmr::polymorphic_allocator<char> allocator() noexcept {
+		return std::pmr::polymorphic_allocator<char>(&arena);
+	}
+	/** frees all memory at once, objects using it must be gone by then */
+	inline void release() noexcept { arena.release(); }
+private:
+	alignas(alignof(std::max_align_t)) unsigned char storage[N];
+	std::pmr::monotonic_buffer_resource arena;
+};
+}
+#endif
+
 namespace wrapper {
 
 template<class Ostream>
@@ -312,18 +488,19 @@ inline const details::value& V() noexcept {
 }
 
 
-template<class C, details::name id, class Vector, Vector C::*M>
+template<class C, details::name id, class Vector, Vector C::*M,
+	size_t Hint = 0>
 inline const details::property<C>&  V() noexcept {
-	return details::PropertyStdVector<C, id, Vector, M>();
+	return details::PropertyStdVector<C, id, Vector, M, Hint>();
 }
 
 /** PropertyArrayOfObjects
  * nested in C array of objects of type T with structure S
  */
 template<class C, details::name id, class Vector, Vector C::*M,
-	const details::clas<typename Vector::value_type>& S()>
+	const details::clas<typename Vector::value_type>& S(), size_t Hint = 0>
 inline const details::property<C> & P() {
-	return details::PropertyStdVector<C, id, Vector, M, S>();
+	return details::PropertyStdVector<C, id, Vector, M, S, Hint>();
 }
 
 #ifdef WITH_COJSON_AUTOS
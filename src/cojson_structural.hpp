@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_structural.hpp - structural index of contiguous JSON text
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <cojson.hpp>
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+namespace cojson {
+namespace structural {
+
+/**
+ * Stage 1: index of brackets and string boundaries of a contiguous text.
+ * The text is classified in blocks of 64 characters into bit masks
+ * (with SSE2 when available), escaped quotes and in-string state are
+ * resolved with bit arithmetic, UTF-8 (for char) and nesting are validated.
+ * Each entry holds a position and the index of its matching entry:
+ * closing bracket for an opening one and vice versa, closing quote
+ * for an opening quote and vice versa.
+ * Commas and colons are not indexed, they are not needed for jumps
+ */
+class index {
+public:
+	typedef uint32_t position_t;
+
+	/** builds index of size characters of data, returns false if the text
+	 *  is malformed at the structural level or is not a valid UTF-8	*/
+	bool build(const char_t* data, std::size_t size) noexcept {
+		using details::error_t;
+		entries.clear();
+		pairs.clear();
+		status = error_t::noerror;
+		failure = 0;
+		if( size > limit ) return fail(error_t::overflow, 0);
+		__try {
+			entries.reserve(size / 8);
+			pairs.reserve(size / 8);
+			stack.clear();
+		} __catch(...) {
+			return fail(error_t::overrun, 0);
+		}
+		state st {};
+		std::size_t pos = 0;
+		for(; pos + block <= size; pos += block)
+			if( ! scan(data, pos, data + pos, st) ) return false;
+		if( pos < size ) {
+			char_t tail[block];
+			std::size_t n = size - pos;
+			for(std::size_t i = 0; i < block; ++i)
+				tail[i] = i < n ? data[pos + i] : ' ';
+			if( ! scan(data, pos, tail, st) ) return false;
+		}
+		if( st.need ) return fail(error_t::bad, size);
+		if( st.instring ) return fail(error_t::bad, entries.back());
+		if( ! stack.empty() ) return fail(error_t::bad, entries[stack.back()]);
+		return true;
+	}
+
+	/** number of entries */
+	inline std::size_t size() const noexcept { return entries.size(); }
+	/** position of the i-th entry in the text */
+	inline position_t position(std::size_t i) const noexcept {
+		return entries[i];
+	}
+	/** index of the entry matching i-th */
+	inline std::size_t match(std::size_t i) const noexcept { return pairs[i]; }
+	/** index of the first entry at or after position pos */
+	std::size_t find(std::size_t pos) const noexcept {
+		std::size_t lo = 0, hi = entries.size();
+		while( lo < hi ) {
+			std::size_t mid = lo + (hi - lo) / 2;
+			if( entries[mid] < pos ) lo = mid + 1;
+			else hi = mid;
+		}
+		return lo;
+	}
+	/** error of the last build */
+	inline details::error_t error() const noexcept { return status; }
+	/** position where the last build failed */
+	inline std::size_t offset() const noexcept { return failure; }
+
+private:
+	static constexpr std::size_t block = 64;
+	static constexpr std::size_t limit =
+		std::numeric_limits<position_t>::max();
+
+	/* bit masks of a block, one bit per character */
+	struct masks {
+		uint64_t quote;
+		uint64_t backslash;
+		uint64_t bracket;	/* { } [ ] */
+		uint64_t high;		/* non-ASCII, for UTF-8 validation */
+	};
+
+	/* state carried between blocks */
+	struct state {
+		uint64_t escaped;	/* first character of the next block is escaped */
+		uint64_t instring;	/* all ones if the next block starts in a string */
+		std::size_t quote;	/* entry of the last opening quote */
+		unsigned need;		/* UTF-8 continuation bytes expected */
+		unsigned char lo, hi;	/* range of the next continuation byte */
+	};
+
+	static inline bool isbracket(unsigned c) noexcept {
+		/* '[' | 0x20 == '{', ']' | 0x20 == '}' */
+		return (c | 0x20) == literal::begin_object ||
+			   (c | 0x20) == literal::end_object;
+	}
+
+	template<typename C>
+	static inline void classify(const C* p, masks& m) noexcept {
+		m = masks {};
+		for(unsigned i = 0; i < block; ++i) {
+			uint64_t bit = uint64_t(1) << i;
+			C c = p[i];
+			if( c == literal::quotation_mark ) m.quote |= bit;
+			else if( c == literal::escape ) m.backslash |= bit;
+			else if( isbracket(static_cast<unsigned>(c)) ) m.bracket |= bit;
+		}
+	}
+
+	static inline void classify(const char* p, masks& m) noexcept {
+#	if defined(__SSE2__)
+		const __m128i quote  = _mm_set1_epi8(literal::quotation_mark);
+		const __m128i escape = _mm_set1_epi8(literal::escape);
+		const __m128i open   = _mm_set1_epi8(literal::begin_object);
+		const __m128i close  = _mm_set1_epi8(literal::end_object);
+		const __m128i lower  = _mm_set1_epi8(0x20);
+		m = masks {};
+		for(unsigned i = 0; i < block / 16; ++i) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p) + i);
+			__m128i l = _mm_or_si128(v, lower);
+			unsigned s = i * 16;
+			m.quote |= uint64_t(static_cast<uint16_t>(
+				_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << s;
+			m.backslash |= uint64_t(static_cast<uint16_t>(
+				_mm_movemask_epi8(_mm_cmpeq_epi8(v, escape)))) << s;
+			m.bracket |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(
+				_mm_or_si128(_mm_cmpeq_epi8(l, open), _mm_cmpeq_epi8(l, close)))))
+				<< s;
+			m.high |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(v))) << s;
+		}
+#	else
+		classify<char>(p, m);
+		for(unsigned i = 0; i < block; ++i)
+			if( p[i] & 0x80 ) m.high |= uint64_t(1) << i;
+#	endif
+	}
+
+	/* characters escaped by odd runs of backslashes */
+	static inline uint64_t escapes(uint64_t backslash, uint64_t& carry)
+			noexcept {
+		static constexpr uint64_t even = 0x5555555555555555ULL;
+		backslash &= ~carry;
+		uint64_t follows = backslash << 1 | carry;
+		uint64_t odd = backslash & ~even & ~follows;
+		uint64_t sum = odd + backslash;
+		carry = sum < odd;
+		return (even ^ (sum << 1)) & follows;
+	}
+
+	/* prefix xor, a bit is set if an odd number of quotes precede it */
+	static inline uint64_t inside(uint64_t quote) noexcept {
+		quote ^= quote << 1;
+		quote ^= quote << 2;
+		quote ^= quote << 4;
+		quote ^= quote << 8;
+		quote ^= quote << 16;
+		quote ^= quote << 32;
+		return quote;
+	}
+
+	static inline unsigned ctz(uint64_t v) noexcept {
+		return __builtin_ctzll(v);
+	}
+
+	bool scan(const char_t* data, std::size_t pos, const char_t* p,
+			state& st) noexcept {
+		using details::error_t;
+		masks m;
+		classify(p, m);
+		if( (m.high || st.need) && ! utf8(p, m.high, pos, st) ) return false;
+		uint64_t quote = m.quote & ~escapes(m.backslash, st.escaped);
+		uint64_t instring = inside(quote) ^ st.instring;
+		st.instring = static_cast<uint64_t>(static_cast<int64_t>(instring) >> 63);
+		uint64_t bits = (m.bracket & ~instring) | quote;
+		__try {
+			while( bits ) {
+				unsigned i = ctz(bits);
+				bits &= bits - 1;
+				std::size_t n = entries.size();
+				entries.push_back(static_cast<position_t>(pos + i));
+				pairs.push_back(n);
+				char_t c = data[pos + i];
+				if( c == literal::quotation_mark ) {
+					if( instring & (uint64_t(1) << i) ) st.quote = n;
+					else {
+						pairs[n] = st.quote;
+						pairs[st.quote] = n;
+					}
+				} else if( c == literal::begin_array ||
+						   c == literal::begin_object ) {
+					stack.push_back(n);
+				} else {
+					if( stack.empty() ) return fail(error_t::bad, pos + i);
+					std::size_t o = stack.back();
+					/* closing bracket of the same kind, ] - [ == } - { == 2 */
+					if( c - data[entries[o]] != 2 )
+						return fail(error_t::bad, pos + i);
+					stack.pop_back();
+					pairs[n] = o;
+					pairs[o] = n;
+				}
+			}
+		} __catch(...) {
+			return fail(error_t::overrun, pos);
+		}
+		return true;
+	}
+
+	template<typename C>
+	static inline bool utf8(const C*, uint64_t, std::size_t, state&) noexcept {
+		return true;
+	}
+
+	bool utf8(const char* p, uint64_t high, std::size_t pos, state& st)
+			noexcept {
+		unsigned i = st.need ? 0 : ctz(high);
+		for(; i < block; ++i) {
+			unsigned char c = static_cast<unsigned char>(p[i]);
+			if( st.need ) {
+				if( c < st.lo || c > st.hi )
+					return fail(details::error_t::bad, pos + i);
+				st.lo = 0x80;
+				st.hi = 0xBF;
+				--st.need;
+				continue;
+			}
+			if( c < 0x80 ) continue;
+			st.lo = 0x80;
+			st.hi = 0xBF;
+			if( c < 0xC2 || c > 0xF4 )
+				return fail(details::error_t::bad, pos + i);
+			if( c < 0xE0 ) st.need = 1;
+			else if( c < 0xF0 ) {
+				st.need = 2;
+				if( c == 0xE0 ) st.lo = 0xA0;	/* overlong */
+				if( c == 0xED ) st.hi = 0x9F;	/* surrogates */
+			} else {
+				st.need = 3;
+				if( c == 0xF0 ) st.lo = 0x90;	/* overlong */
+				if( c == 0xF4 ) st.hi = 0x8F;	/* above U+10FFFF */
+			}
+		}
+		return true;
+	}
+
+	bool fail(details::error_t e, std::size_t pos) noexcept {
+		status = e;
+		failure = pos;
+		return false;
+	}
+
+	typedef details::literal literal;
+	std::vector<position_t> entries;
+	std::vector<std::size_t> pairs;
+	std::vector<std::size_t> stack;
+	details::error_t status = details::error_t::noerror;
+	std::size_t failure = 0;
+};
+
+/**
+ * Stage 2: input stream over an indexed text.
+ * Binding works with the regular descriptors, the lexer reads strings
+ * through the window and skips unknown members and mismatched values
+ * by jumping to the matching closing entry of the index.
+ * Skipped content is validated only at the structural level
+ * Usage:
+ *   structural::index idx;
+ *   if( idx.build(text, size) ) {
+ *     structural::stream in(idx, text, size);
+ *     details::lexer lex(in);
+ *     Device::structure().read(device, lex);
+ *   }
+ */
+class stream : public details::istream {
+public:
+	inline stream(const index& idx, const char_t* data, std::size_t size)
+	  noexcept : idx(idx), data(data), size(size), pos(0) {}
+
+	bool get(char_t& c) noexcept {
+		if( pos < size ) {
+			c = data[pos++];
+			return true;
+		}
+		c = details::iostate::eos_c;
+		istream::error(details::error_t::eof);
+		return false;
+	}
+	const char_t* window(size_t& n) noexcept {
+		std::size_t left = size - pos;
+		n = left > limit ? limit : static_cast<size_t>(left);
+		return n ? data + pos : nullptr;
+	}
+	void advance(size_t n) noexcept {
+		pos += n;
+	}
+	bool windowed() const noexcept {
+		return true;
+	}
+	bool jump(char_t held, bool list) noexcept {
+		std::size_t from = pos;
+		if( held ) {
+			if( from == 0 || data[from - 1] != held ) return false;
+			--from;
+		}
+		if( list ) return remainder(from);
+		while( from < size && isspace(data[from]) ) ++from;
+		if( from == size ) return false;
+		switch( data[from] ) {
+		case literal::quotation_mark:
+		case literal::begin_array:
+		case literal::begin_object: {
+			std::size_t i = idx.find(from);
+			if( i == idx.size() || idx.position(i) != from ) return false;
+			pos = idx.position(idx.match(i)) + 1;
+			return true;
+		}
+		default:
+			/* scalars are left to the lexer */
+			return false;
+		}
+	}
+	/** current position in the text */
+	inline std::size_t position() const noexcept { return pos; }
+private:
+	typedef details::literal literal;
+	static constexpr std::size_t limit =
+		std::numeric_limits<cojson::size_t>::max();
+
+	static inline bool isspace(char_t c) noexcept {
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	/* moves to the closing bracket of the enclosing array */
+	bool remainder(std::size_t from) noexcept {
+		for(std::size_t i = idx.find(from); i < idx.size(); ++i) {
+			std::size_t m = idx.match(i);
+			if( m > i ) {
+				i = m;
+				continue;
+			}
+			if( data[idx.position(i)] != literal::end_array ) return false;
+			pos = idx.position(i);
+			return true;
+		}
+		return false;
+	}
+
+	const index& idx;
+	const char_t* data;
+	std::size_t size;
+	std::size_t pos;
+};
+
+}
+}
@@ -0,0 +1,590 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_tape.hpp - tape DOM for documents of unknown shape
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <cojson.hpp>
+
+namespace cojson {
+namespace tape {
+
+/**
+ * A tape is a flat array of 64-bit entries in document order, a tag in
+ * the upper byte and a payload in the lower 56 bits:
+ *   n t f		null, true, false
+ *   l d		integer, number, the value is in the next entry
+ *   s k		string, member name: length << 32 | offset of characters
+ *   [ {		container: count << 32 | index past the closing entry
+ *   ] }		closing entry: index of the opening entry
+ */
+typedef uint64_t entry;
+
+enum tag_t : unsigned char {
+	t_null		= 'n',
+	t_true		= 't',
+	t_false		= 'f',
+	t_integer	= 'l',
+	t_number	= 'd',
+	t_string	= 's',
+	t_key		= 'k',
+	t_array		= '[',
+	t_array_end	= ']',
+	t_object	= '{',
+	t_object_end= '}'
+};
+
+static inline constexpr tag_t tagof(entry e) noexcept {
+	return static_cast<tag_t>(e >> 56);
+}
+static inline constexpr entry make(tag_t t, uint64_t payload) noexcept {
+	return (static_cast<entry>(t) << 56) | payload;
+}
+static inline constexpr uint32_t low(entry e) noexcept {
+	return static_cast<uint32_t>(e);
+}
+static inline constexpr uint32_t high(entry e) noexcept {
+	return static_cast<uint32_t>(e >> 32) & 0xFFFFFF;
+}
+
+/**
+ * Caller supplied memory for a document. Tape entries are allocated
+ * from the front, strings from the back
+ * Usage:
+ *   static uint64_t memory[1024];
+ *   tape::arena arena(memory);
+ */
+class arena {
+public:
+	arena(void* data, std::size_t size) noexcept
+	  : begin(align(data)),
+		end(reinterpret_cast<char*>(data) + size) {
+		if( reinterpret_cast<char*>(begin) > end )
+			begin = reinterpret_cast<entry*>(end);
+		reset();
+	}
+	template<typename T, std::size_t N>
+	arena(T (&data)[N]) noexcept : arena(data, sizeof(data)) {}
+	/** total size in bytes */
+	inline std::size_t size() const noexcept {
+		return end - reinterpret_cast<char*>(begin);
+	}
+	/** bytes used by the document */
+	inline std::size_t used() const noexcept {
+		return size() - free();
+	}
+	/** releases all allocated memory */
+	inline void reset() noexcept {
+		front = 0;
+		back = end;
+	}
+private:
+	friend class document;
+	static entry* align(void* data) noexcept {
+		uintptr_t p = reinterpret_cast<uintptr_t>(data);
+		p = (p + alignof(entry) - 1) & ~uintptr_t(alignof(entry) - 1);
+		return reinterpret_cast<entry*>(p);
+	}
+	/* bytes between tape and strings */
+	inline std::size_t free() const noexcept {
+		return back - reinterpret_cast<char*>(begin + front);
+	}
+	entry* begin;
+	char* end;
+	uint32_t front;
+	char* back;
+};
+
+/**
+ * A value on the tape, a lightweight view valid while the arena is
+ */
+class value {
+public:
+	enum class type_t : unsigned char {
+		none, null, boolean, integer, number, string, array, object
+	};
+	inline value() noexcept : tape(nullptr), base(nullptr), at(0) {}
+
+	type_t type() const noexcept {
+		if( tape == nullptr ) return type_t::none;
+		switch( tag() ) {
+		case t_null:	return type_t::null;
+		case t_true:
+		case t_false:	return type_t::boolean;
+		case t_integer:	return type_t::integer;
+		case t_number:	return type_t::number;
+		case t_string:
+		case t_key:		return type_t::string;
+		case t_array:	return type_t::array;
+		case t_object:	return type_t::object;
+		default:		return type_t::none;
+		}
+	}
+	/** false for a value not found */
+	inline explicit operator bool() const noexcept { return tape != nullptr; }
+	inline bool boolean() const noexcept {
+		return tape && tag() == t_true;
+	}
+	/** integer value, numbers are truncated */
+	long long integer() const noexcept {
+		if( ! tape ) return 0;
+		if( tag() == t_integer ) return static_cast<long long>(tape[at + 1]);
+		if( tag() == t_number ) return static_cast<long long>(number());
+		return 0;
+	}
+	/** number value, integers are converted */
+	double number() const noexcept {
+		if( ! tape ) return 0;
+		if( tag() == t_integer ) return static_cast<long long>(tape[at + 1]);
+		if( tag() != t_number ) return 0;
+		double val;
+		memcpy(&val, tape + at + 1, sizeof(val));
+		return val;
+	}
+	/** zero terminated string, nullptr for other types */
+	const char_t* string() const noexcept {
+		if( ! tape || (tag() != t_string && tag() != t_key) ) return nullptr;
+		return reinterpret_cast<const char_t*>(base + low(tape[at]));
+	}
+	/** number of elements or members, length of a string */
+	size_t size() const noexcept {
+		if( ! tape ) return 0;
+		switch( tag() ) {
+		case t_array:
+		case t_object:
+			if( high(tape[at]) == 0xFFFFFF ) break;	/* saturated */
+			/* FALLTHRU */
+		case t_string:
+			return high(tape[at]);
+		default:
+			return 0;
+		}
+		size_t n = 0;
+		for(iterator i = begin(); i != end(); ++i) ++n;
+		return n;
+	}
+
+	/**
+	 * Iterates elements of an array or members of an object
+	 */
+	class iterator {
+	public:
+		inline value operator*() const noexcept {
+			return value(tape, base, object ? at + 1 : at);
+		}
+		/** member name, nullptr for arrays */
+		inline const char_t* key() const noexcept {
+			return object ? value(tape, base, at).string() : nullptr;
+		}
+		inline iterator& operator++() noexcept {
+			at = next(tape, object ? at + 1 : at);
+			return *this;
+		}
+		inline bool operator!=(const iterator& that) const noexcept {
+			return at != that.at;
+		}
+	private:
+		friend class value;
+		inline iterator(const entry* t, const char* b, uint32_t at, bool o)
+		  noexcept : tape(t), base(b), at(at), object(o) {}
+		const entry* tape;
+		const char* base;
+		uint32_t at;
+		bool object;
+	};
+	iterator begin() const noexcept {
+		bool container = tape && (tag() == t_array || tag() == t_object);
+		return iterator(tape, base, container ? at + 1 : at,
+			tape && tag() == t_object);
+	}
+	iterator end() const noexcept {
+		bool container = tape && (tag() == t_array || tag() == t_object);
+		return iterator(tape, base, container ? low(tape[at]) - 1 : at,
+			tape && tag() == t_object);
+	}
+
+	/** array element by index, none if out of range */
+	value operator[](size_t index) const noexcept {
+		if( ! tape || tag() != t_array ) return value();
+		for(iterator i = begin(); i != end(); ++i)
+			if( index-- == 0 ) return *i;
+		return value();
+	}
+	/* resolves ambiguity of literal 0 with a name */
+	inline value operator[](int index) const noexcept {
+		return index < 0 ? value() : (*this)[static_cast<size_t>(index)];
+	}
+	/** object member by name, none if not found */
+	value operator[](const char_t* name) const noexcept {
+		if( ! tape || tag() != t_object ) return value();
+		for(iterator i = begin(); i != end(); ++i)
+			if( details::match(i.key(), name) ) return *i;
+		return value();
+	}
+
+	/** writes the value with the regular writers */
+	bool write(details::ostream& out) const noexcept {
+		using namespace details;
+		if( ! tape ) return details::value::null(out);
+		uint32_t last = next(tape, at);
+		tag_t prev = t_array;
+		for(uint32_t i = at; i < last; i = step(tape, i)) {
+			tag_t t = tagof(tape[i]);
+			char_t s = separator(prev, t);
+			if( s && ! out.put(s) ) return false;
+			if( ! token(i, out) ) return false;
+			prev = t;
+		}
+		return true;
+	}
+
+	/** binds the value to an object with a class descriptor */
+	template<class C>
+	bool read(C& obj, const details::clas<C>& structure) const noexcept;
+private:
+	friend class document;
+	friend class stream;
+	inline value(const entry* t, const char* b, uint32_t at) noexcept
+	  : tape(t), base(b), at(at) {}
+	inline tag_t tag() const noexcept { return tagof(tape[at]); }
+
+	/* index of the entry following a value, its closing entry included */
+	static inline uint32_t next(const entry* tape, uint32_t i) noexcept {
+		switch( tagof(tape[i]) ) {
+		case t_array:
+		case t_object:
+			return low(tape[i]);
+		default:
+			return step(tape, i);
+		}
+	}
+	/* index of the next entry in document order */
+	static inline uint32_t step(const entry* tape, uint32_t i) noexcept {
+		tag_t t = tagof(tape[i]);
+		return i + (t == t_integer || t == t_number ? 2 : 1);
+	}
+	/* separator written between entries */
+	static inline char_t separator(tag_t prev, tag_t t) noexcept {
+		using details::literal;
+		if( t == t_array_end || t == t_object_end ) return 0;
+		if( prev == t_array || prev == t_object ) return 0;
+		return prev == t_key ? literal::name_separator
+							 : literal::value_separator;
+	}
+	/* writes a single entry, strings are written whole */
+	bool token(uint32_t i, details::ostream& out) const noexcept {
+		using namespace details;
+		value v(tape, base, i);
+		switch( v.tag() ) {
+		case t_null:
+			return details::value::null(out);
+		case t_true:
+		case t_false:
+			return writer<bool>::write(v.tag() == t_true, out);
+		case t_integer:
+			return writer<long long>::write(v.integer(), out);
+		case t_number:
+			return writer<double>::write(v.number(), out);
+		case t_string:
+		case t_key:
+			return writer<const char_t*>::write(v.string(), out);
+		default:
+			return out.put(static_cast<char_t>(v.tag()));
+		}
+	}
+
+	const entry* tape;
+	const char* base;
+	uint32_t at;
+};
+
+/**
+ * Document parsed onto a tape in the arena, without heap allocation.
+ * Memory used is proportional to the number of tokens plus
+ * the length of strings
+ * Usage:
+ *   tape::document doc(arena);
+ *   if( doc.read(input) ) {
+ *     long long id = doc.root()["id"].integer();
+ *   }
+ */
+class document {
+public:
+	inline document(arena& mem) noexcept : mem(mem) {}
+	/** parses a single value, arena is reused, returns false on error */
+	bool read(details::lexer& in) noexcept {
+		using namespace details;
+		mem.reset();
+		result = value();
+		static constexpr uint32_t none = 0xFFFFFFFF;
+		uint32_t parent = none;
+		bool object = false;
+		char_t c;
+		for(;;) {
+			/* an element: a value, in objects preceded by a name */
+			if( parent != none ) count(parent);
+			if( object && ! key(in) ) return false;
+			if( ! in.skipws(c) ) return fail(in, c);
+			if( c == literal::begin_object || c == literal::begin_array ) {
+				if( ! push(make(c == literal::begin_object ? t_object : t_array,
+						parent), in) ) return false;
+				parent = mem.front - 1;
+				object = c == literal::begin_object;
+				if( ! in.skipws(c) ) return fail(in, c);
+				if( c != (object ? literal::end_object : literal::end_array) ) {
+					in.back(c);
+					continue;
+				}
+				if( ! close(parent, object, in) ) return false;
+			} else {
+				in.back(c);
+				if( ! scalar(in) ) return false;
+			}
+			/* after a value: a separator or closing brackets */
+			for(;;) {
+				if( parent == none ) {
+					result = value(mem.begin, reinterpret_cast<char*>(mem.begin), 0);
+					return true;
+				}
+				if( ! in.skipws(c) ) return fail(in, c);
+				if( c == literal::value_separator ) break;
+				if( c != (object ? literal::end_object : literal::end_array) ) {
+					in.error(error_t::bad);
+					return false;
+				}
+				if( ! close(parent, object, in) ) return false;
+			}
+		}
+	}
+	bool read(details::istream& in) noexcept {
+		details::lexer lex(in);
+		return read(lex);
+	}
+	/** the root value, none if the last read failed */
+	inline value root() const noexcept { return result; }
+	/** number of tape entries */
+	inline size_t size() const noexcept { return result ? mem.front : 0; }
+private:
+	static constexpr uint32_t saturated = 0xFFFFFF;
+
+	inline bool fail(details::lexer& in, char_t c) noexcept {
+		in.bad(c);
+		return false;
+	}
+	inline bool push(entry e, details::lexer& in) noexcept {
+		if( mem.free() < sizeof(entry) ) {
+			in.error(details::error_t::overflow);
+			return false;
+		}
+		mem.begin[mem.front++] = e;
+		return true;
+	}
+	/* counts an element of a container, saturated */
+	inline void count(uint32_t parent) noexcept {
+		entry& e = mem.begin[parent];
+		if( high(e) != saturated ) e += entry(1) << 32;
+	}
+	/* closes a container, the opening entry holds the link to its parent */
+	bool close(uint32_t& parent, bool& object, details::lexer& in) noexcept {
+		entry& e = mem.begin[parent];
+		uint32_t up = low(e);
+		tag_t t = tagof(e);
+		if( ! push(make(t == t_object ? t_object_end : t_array_end, parent),
+				in) ) return false;
+		e = make(t, (entry(high(e)) << 32) | mem.front);
+		parent = up;
+		object = up != 0xFFFFFFFF && tagof(mem.begin[up]) == t_object;
+		return true;
+	}
+	bool key(details::lexer& in) noexcept {
+		using namespace details;
+		char_t c;
+		if( ! in.skipws(c) ) return fail(in, c);
+		if( c != literal::quotation_mark ) return fail(in, c);
+		in.back(c);
+		if( ! string(in, t_key) ) return false;
+		if( ! in.skipws(c) ) return fail(in, c);
+		if( c != literal::name_separator ) return fail(in, c);
+		return true;
+	}
+	/* reads a string into the gap and moves it to the back */
+	bool string(details::lexer& in, tag_t t) noexcept {
+		using namespace details;
+		std::size_t gap = mem.free();
+		if( gap < sizeof(entry) + sizeof(char_t) ) {
+			in.error(error_t::overflow);
+			return false;
+		}
+		char_t* dst = reinterpret_cast<char_t*>(mem.begin + mem.front + 1);
+		const error_t before = in.error() & error_t::overrun;
+		if( ! reader<char_t*>::read(dst, (gap - sizeof(entry)) / sizeof(char_t),
+				in) ) return false;
+		std::size_t len = 0;
+		while( dst[len] ) ++len;
+		/* a string truncated at the end of the gap does not fit the arena */
+		if( (in.error() & error_t::overrun) != before || len >= saturated ) {
+			in.error(error_t::overflow);
+			return false;
+		}
+		char_t* str = reinterpret_cast<char_t*>(mem.back) - (len + 1);
+		memmove(str, dst, (len + 1) * sizeof(char_t));
+		mem.back = reinterpret_cast<char*>(str);
+		std::size_t offset = mem.back - reinterpret_cast<char*>(mem.begin);
+		return push(make(t, (entry(len) << 32) | offset), in);
+	}
+	bool scalar(details::lexer& in) noexcept {
+		using namespace details;
+		ctype ct = in.value(ctype::literal | ctype::number | ctype::string);
+		if( ct == ctype::null ) return push(make(t_null, 0), in);
+		if( ct == (ctype::boolean | ctype::value) )
+			return push(make(t_true, 0), in);
+		if( ct == ctype::boolean ) return push(make(t_false, 0), in);
+		if( ct == ctype::string ) return string(in, t_string);
+		if( ! hasbits(ct, ctype::number) ) return false;
+		return number(in);
+	}
+	/* collects a number lexeme and converts it with the regular readers */
+	bool number(details::lexer& in) noexcept {
+		using namespace details;
+		char_t lexeme[40];
+		size_t len = 0;
+		bool integral = true;
+		char_t c;
+		ctype ct;
+		while( hasbits(ct = in.get(c, ctype::number), ctype::number) ) {
+			if( len == countof(lexeme) ) {
+				in.error(error_t::overflow);
+				return false;
+			}
+			if( ! hasbits(ct, ctype::digit) && c != literal::minus )
+				integral = false;
+			lexeme[len++] = c;
+		}
+		if( ct == ctype::unknown ) in.back(c);
+		else if( ct != ctype::eof ) return false;
+		/* up to 18 digits always fit in long long */
+		if( integral && len <= 18 ) {
+			long long val;
+			wrapper::buffer buf(lexeme, len);
+			lexer lex(buf);
+			if( ! reader<long long>::read(val, lex) ) {
+				in.error(lex.error());
+				return false;
+			}
+			return push(make(t_integer, 0), in) &&
+				push(static_cast<entry>(val), in);
+		}
+		double val;
+		wrapper::buffer buf(lexeme, len);
+		lexer lex(buf);
+		if( ! reader<double>::read(val, lex) ) {
+			in.error(lex.error());
+			return false;
+		}
+		entry bits;
+		memcpy(&bits, &val, sizeof(bits));
+		return push(make(t_number, 0), in) && push(bits, in);
+	}
+
+	arena& mem;
+	value result;
+};
+
+/**
+ * Input stream rendering a tape value as JSON text, so that class
+ * descriptors can bind from it. Tokens are rendered one at a time
+ * Usage:
+ *   tape::stream in(doc.root()["user"]);
+ *   lexer lex(in);
+ *   User::structure().read(user, lex);
+ */
+class stream : public details::istream {
+public:
+	inline stream(const value& v) noexcept : val(v), at(v.at),
+		last(v.tape ? value::next(v.tape, v.at) : v.at) {}
+	bool get(char_t& c) noexcept {
+		using namespace details;
+		while( pos == piece.len ) {
+			if( ! fill() ) {
+				c = iostate::eos_c;
+				istream::error(error_t::eof);
+				return false;
+			}
+		}
+		c = piece.buf[pos++];
+		return true;
+	}
+private:
+	/* a piece of rendered text */
+	struct chunk : details::ostream {
+		bool put(char_t c) noexcept {
+			if( len == details::countof(buf) ) return false;
+			buf[len++] = c;
+			return true;
+		}
+		char_t buf[32];
+		size_t len = 0;
+	};
+	bool fill() noexcept {
+		using namespace details;
+		pos = piece.len = 0;
+		if( str ) {
+			/* plain characters in bulk, others escaped one at a time */
+			while( *str && piece.len < countof(piece.buf) &&
+				! literal::is_control(*str) && ! literal::is_escaped(*str) )
+				piece.buf[piece.len++] = *str++;
+			if( piece.len ) return true;
+			if( *str ) return writer<const char_t*>::write(*str++, piece);
+			str = nullptr;
+			return piece.put(literal::quotation_mark);
+		}
+		if( at >= last ) return false;
+		tag_t t = tagof(val.tape[at]);
+		char_t s = value::separator(prev, t);
+		if( s ) piece.put(s);
+		prev = t;
+		uint32_t i = at;
+		at = value::step(val.tape, at);
+		if( t == t_string || t == t_key ) {
+			str = value(val.tape, val.base, i).string();
+			return piece.put(literal::quotation_mark);
+		}
+		return val.token(i, piece);
+	}
+	value val;
+	uint32_t at;
+	uint32_t last;
+	tag_t prev = t_array;
+	const char_t* str = nullptr;
+	chunk piece;
+	size_t pos = 0;
+};
+
+template<class C>
+bool value::read(C& obj, const details::clas<C>& structure) const noexcept {
+	stream in(*this);
+	details::lexer lex(in);
+	return structure.read(obj, lex);
+}
+
+}
+}
@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * cojson_validate.hpp - validation of JSON text without binding
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ * This file is part of µcuREST Library. http://hutorny.in.ua/projects/micurest
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <cojson.hpp>
+
+namespace cojson {
+
+/**
+ * Optional limits for validation, 0 means no limit
+ */
+struct limits {
+	size_t depth = 0;		/** nesting depth of arrays and objects		*/
+	std::size_t size = 0;	/** document size in characters				*/
+	size_t string = 0;		/** string length in characters				*/
+	size_t number = 0;		/** number length in characters				*/
+};
+
+/**
+ * Incremental validator of a single JSON document (RFC 8259): grammar,
+ * number syntax, string escapes, surrogate pairs and, for char, UTF-8.
+ * The text is fed in runs of characters, plain string characters and
+ * whitespace are scanned in tight loops with a character class table.
+ * Errors are bad for malformed text and overflow for exceeded limits
+ * Depth - maximal nesting depth supported
+ */
+template<unsigned Depth = 256>
+class validator {
+public:
+	inline validator(const limits& lim = limits()) noexcept : lim(lim) {
+		if( this->lim.depth == 0 || this->lim.depth > Depth )
+			this->lim.depth = Depth;
+	}
+
+	/** validates next n characters, returns false on error */
+	bool feed(const char_t* p, std::size_t n) noexcept {
+		if( state == s_error ) return false;
+		if( lim.size && n > lim.size - total ) {
+			n = lim.size - total;
+			if( ! scan(p, n) ) return false;
+			return fail(error_t::overflow, 0);
+		}
+		return scan(p, n);
+	}
+
+	/** signals end of input, returns true if a complete document was read */
+	bool finish() noexcept {
+		switch( state ) {
+		case s_zero: case s_int: case s_frac: case s_exp:
+			if( depth == 0 ) return true;
+			break;
+		case s_done:
+			return true;
+		case s_error:
+			return false;
+		default:;
+		}
+		return fail(error_t::bad, 0);
+	}
+
+	/** error of validation, noerror if no error found */
+	inline details::error_t error() const noexcept { return err; }
+	/** offset of the character where validation failed */
+	inline std::size_t offset() const noexcept { return failure; }
+	/** number of characters validated so far */
+	inline std::size_t size() const noexcept { return total; }
+private:
+	typedef details::error_t error_t;
+	typedef details::literal literal;
+	typedef typename std::make_unsigned<char_t>::type uchar_t;
+
+	enum state_t : unsigned char {
+		s_value,		/* a value expected									*/
+		s_first,		/* a value or ] after [								*/
+		s_key_first,	/* a name or } after {								*/
+		s_key,			/* a name after ,									*/
+		s_colon,		/* : after a name									*/
+		s_next,			/* , or closing bracket after a value				*/
+		s_done,			/* whitespace after the document					*/
+		s_string,		/* string characters								*/
+		s_escape,		/* character after \								*/
+		s_hex,			/* hex digits of \uXXXX								*/
+		s_low_escape,	/* \ of a low surrogate								*/
+		s_low_u,		/* u of a low surrogate								*/
+		s_utf8,			/* UTF-8 continuation bytes							*/
+		s_minus,		/* a digit after -									*/
+		s_zero,			/* leading zero										*/
+		s_int,			/* integer digits									*/
+		s_dot,			/* a digit after .									*/
+		s_frac,			/* fraction digits									*/
+		s_e,			/* sign or digit after e							*/
+		s_esign,		/* a digit after exponent sign						*/
+		s_exp,			/* exponent digits									*/
+		s_literal,		/* true, false or null								*/
+		s_error
+	};
+
+	enum cls_t : unsigned char {
+		plain = 1,		/* string character without escaping				*/
+		space = 2,		/* whitespace										*/
+		digit = 4		/* decimal digit									*/
+	};
+
+	/* character class table for ASCII */
+	struct table {
+		unsigned char cls[128];
+		constexpr table() noexcept : cls() {
+			for(unsigned c = 0x20; c < 128; ++c)
+				if( c != literal::quotation_mark && c != literal::escape )
+					cls[c] = plain;
+			cls[static_cast<unsigned>(' ')] |= space;
+			cls[static_cast<unsigned>('\t')] = space;
+			cls[static_cast<unsigned>('\n')] = space;
+			cls[static_cast<unsigned>('\r')] = space;
+			for(unsigned c = '0'; c <= '9'; ++c)
+				cls[c] |= digit;
+		}
+	};
+
+	/* non-ASCII characters are plain for wide characters,
+	 * for char they go through UTF-8 validation */
+	static inline unsigned char classof(char_t c) noexcept {
+		static constexpr table t {};
+		if( static_cast<uchar_t>(c) < 128 ) return t.cls[static_cast<uchar_t>(c)];
+		return sizeof(char_t) == 1 ? 0 : plain;
+	}
+
+	static inline bool ishex(char_t c, unsigned& v) noexcept {
+		if( c >= '0' && c <= '9' ) v = c - '0';
+		else if( c >= 'a' && c <= 'f' ) v = c - 'a' + 10;
+		else if( c >= 'A' && c <= 'F' ) v = c - 'A' + 10;
+		else return false;
+		return true;
+	}
+
+	bool fail(error_t e, std::size_t i) noexcept {
+		state = s_error;
+		err = e;
+		failure = total + i;
+		return false;
+	}
+
+	inline bool push(bool object) noexcept {
+		if( depth >= lim.depth ) return false;
+		unsigned bit = 1u << (depth % 8);
+		if( object ) stack[depth / 8] |= bit;
+		else stack[depth / 8] &= ~bit;
+		++depth;
+		return true;
+	}
+	inline bool top() const noexcept {
+		return (stack[(depth - 1) / 8] >> ((depth - 1) % 8)) & 1;
+	}
+	/* state after a complete value */
+	inline void ended() noexcept {
+		state = depth ? s_next : s_done;
+	}
+
+	/* starts a value at character c, returns false if c can't start it */
+	bool start(char_t c, std::size_t i) noexcept {
+		switch( c ) {
+		case literal::begin_object:
+			if( ! push(true) ) return fail(error_t::overflow, i);
+			state = s_key_first;
+			return true;
+		case literal::begin_array:
+			if( ! push(false) ) return fail(error_t::overflow, i);
+			state = s_first;
+			return true;
+		case literal::quotation_mark:
+			key = false;
+			count = 0;
+			state = s_string;
+			return true;
+		case literal::minus:
+			state = s_minus;
+			break;
+		case '0':
+			state = s_zero;
+			break;
+		case 't':
+			lit = literal::true_l();
+			break;
+		case 'f':
+			lit = literal::false_l();
+			break;
+		case 'n':
+			lit = literal::null_l();
+			break;
+		default:
+			if( c < '1' || c > '9' ) return fail(error_t::bad, i);
+			state = s_int;
+		}
+		count = 1;
+		if( state == s_value || state == s_first ) state = s_literal;
+		return true;
+	}
+
+	bool scan(const char_t* p, std::size_t n) noexcept {
+		std::size_t i = 0;
+		while( i < n ) {
+			char_t c = p[i];
+			switch( state ) {
+			case s_string: {
+				std::size_t from = i;
+				while( i < n && (classof(p[i]) & plain) ) ++i;
+				count += i - from;
+				if( lim.string && count > lim.string )
+					return fail(error_t::overflow, i - (count - lim.string));
+				if( i == n ) continue;
+				c = p[i];
+				if( c == literal::quotation_mark ) {
+					if( key ) state = s_colon;
+					else ended();
+				} else if( c == literal::escape ) {
+					state = s_escape;
+				} else if( static_cast<uchar_t>(c) < 0x20 ) {
+					return fail(error_t::bad, i);
+				} else if( ! utf8(static_cast<uchar_t>(c)) ) {
+					return fail(error_t::bad, i);
+				} else if( ! counted() ) {
+					return fail(error_t::overflow, i);
+				}
+				break;
+			}
+			case s_utf8: {
+				uchar_t u = static_cast<uchar_t>(c);
+				if( u < lo || u > hi ) return fail(error_t::bad, i);
+				lo = 0x80;
+				hi = 0xBF;
+				if( --need == 0 ) state = s_string;
+				break;
+			}
+			case s_escape:
+				switch( c ) {
+				case literal::quotation_mark: case literal::escape:
+				case literal::slash:
+				case 'b': case 'f': case 'n': case 'r': case 't':
+					if( ! counted() ) return fail(error_t::overflow, i);
+					state = s_string;
+					break;
+				case 'u':
+					hexn = code = 0;
+					state = s_hex;
+					break;
+				default:
+					return fail(error_t::bad, i);
+				}
+				break;
+			case s_hex: {
+				unsigned v;
+				if( ! ishex(c, v) ) return fail(error_t::bad, i);
+				code = (code << 4) | v;
+				if( ++hexn < 4 ) break;
+				bool lead = code >= 0xD800 && code <= 0xDBFF;
+				bool trail = code >= 0xDC00 && code <= 0xDFFF;
+				if( surrogate ) {
+					if( ! trail ) return fail(error_t::bad, i);
+					surrogate = false;
+				} else if( trail ) {
+					return fail(error_t::bad, i);
+				} else if( ! counted() ) {
+					return fail(error_t::overflow, i);
+				}
+				if( lead ) {
+					surrogate = true;
+					state = s_low_escape;
+				} else state = s_string;
+				break;
+			}
+			case s_low_escape:
+				if( c != literal::escape ) return fail(error_t::bad, i);
+				state = s_low_u;
+				break;
+			case s_low_u:
+				if( c != 'u' ) return fail(error_t::bad, i);
+				hexn = code = 0;
+				state = s_hex;
+				break;
+			case s_value:
+			case s_first:
+				while( i < n && (classof(p[i]) & space) ) ++i;
+				if( i == n ) continue;
+				c = p[i];
+				if( state == s_first && c == literal::end_array ) {
+					--depth;
+					ended();
+				} else if( ! start(c, i) ) return false;
+				break;
+			case s_next:
+				while( i < n && (classof(p[i]) & space) ) ++i;
+				if( i == n ) continue;
+				c = p[i];
+				if( c == literal::value_separator ) {
+					state = top() ? s_key : s_value;
+				} else if( top() ? c == literal::end_object
+								 : c == literal::end_array ) {
+					--depth;
+					ended();
+				} else return fail(error_t::bad, i);
+				break;
+			case s_key_first:
+			case s_key:
+				while( i < n && (classof(p[i]) & space) ) ++i;
+				if( i == n ) continue;
+				c = p[i];
+				if( c == literal::quotation_mark ) {
+					key = true;
+					count = 0;
+					state = s_string;
+				} else if( state == s_key_first && c == literal::end_object ) {
+					--depth;
+					ended();
+				} else return fail(error_t::bad, i);
+				break;
+			case s_colon:
+				while( i < n && (classof(p[i]) & space) ) ++i;
+				if( i == n ) continue;
+				if( p[i] != literal::name_separator ) return fail(error_t::bad, i);
+				state = s_value;
+				break;
+			case s_done:
+				while( i < n && (classof(p[i]) & space) ) ++i;
+				if( i == n ) continue;
+				return fail(error_t::bad, i);
+			case s_literal:
+				if( c != lit[count] ) return fail(error_t::bad, i);
+				if( lit[++count] == 0 ) ended();
+				break;
+			default:
+				if( ! number(c, i) ) return false;
+				continue;	/* a character ending the number is seen again */
+			case s_error:
+				return false;
+			}
+			++i;
+		}
+		total += n;
+		return true;
+	}
+
+	/* advances number state over c, returns false on error */
+	bool number(char_t c, std::size_t& i) noexcept {
+		bool d = classof(c) & digit;
+		switch( state ) {
+		case s_minus:
+			if( c == '0' ) state = s_zero;
+			else if( d ) state = s_int;
+			else return fail(error_t::bad, i);
+			break;
+		case s_zero:
+			if( d ) return fail(error_t::bad, i);
+			/* FALLTHRU */
+		case s_int:
+			if( d ) break;
+			if( c == literal::decimal ) state = s_dot;
+			else if( c == 'e' || c == 'E' ) state = s_e;
+			else return end();
+			break;
+		case s_dot:
+			if( ! d ) return fail(error_t::bad, i);
+			state = s_frac;
+			break;
+		case s_frac:
+			if( d ) break;
+			if( c == 'e' || c == 'E' ) state = s_e;
+			else return end();
+			break;
+		case s_e:
+			if( c == literal::plus || c == literal::minus ) state = s_esign;
+			else if( d ) state = s_exp;
+			else return fail(error_t::bad, i);
+			break;
+		case s_esign:
+			if( ! d ) return fail(error_t::bad, i);
+			state = s_exp;
+			break;
+		case s_exp:
+			if( d ) break;
+			return end();
+		default:
+			return fail(error_t::bad, i);
+		}
+		if( lim.number && ++count > lim.number )
+			return fail(error_t::overflow, i);
+		++i;
+		return true;
+	}
+	/* ends a number at a character that is not a part of it */
+	inline bool end() noexcept {
+		count = 0;
+		ended();
+		return true;
+	}
+
+	limits lim;
+	std::size_t total = 0;
+	std::size_t failure = 0;
+	size_t count = 0;		/* string, number or literal characters			*/
+	size_t depth = 0;
+	cstring lit = nullptr;
+	unsigned code = 0;
+	unsigned char hexn = 0;
+	unsigned char need = 0;
+	unsigned char lo = 0x80, hi = 0xBF;
+	bool key = false;
+	bool surrogate = false;
+	state_t state = s_value;
+	error_t err = error_t::noerror;
+	unsigned char stack[(Depth + 7) / 8] = {};
+
+	/* counts a string character against the limit */
+	inline bool counted() noexcept {
+		return ++count <= lim.string || lim.string == 0;
+	}
+
+	/* checks a non-ASCII character, starts UTF-8 sequence */
+	bool utf8(uchar_t c) noexcept {
+		if( sizeof(char_t) != 1 ) return true;
+		if( c < 0xC2 || c > 0xF4 ) return false;
+		lo = 0x80;
+		hi = 0xBF;
+		if( c < 0xE0 ) need = 1;
+		else if( c < 0xF0 ) {
+			need = 2;
+			if( c == 0xE0 ) lo = 0xA0;	/* overlong */
+			if( c == 0xED ) hi = 0x9F;	/* surrogates */
+		} else {
+			need = 3;
+			if( c == 0xF0 ) lo = 0x90;	/* overlong */
+			if( c == 0xF4 ) hi = 0x8F;	/* above U+10FFFF */
+		}
+		state = s_utf8;
+		return true;
+	}
+};
+
+/**
+ * Validates a JSON document read from a stream, windowed streams
+ * are validated in runs, others character by character.
+ * offset, if given, receives offset of the failure
+ */
+template<unsigned Depth = 256>
+bool Validate(details::istream& in, const limits& lim = limits(),
+		std::size_t* offset = nullptr) noexcept {
+	validator<Depth> v(lim);
+	bool r = true;
+	while( r ) {
+		size_t len = 0;
+		const char_t* p = in.window(len);
+		if( p != nullptr && len != 0 ) {
+			r = v.feed(p, len);
+			in.advance(len);
+			continue;
+		}
+		char_t c;
+		if( ! in.get(c) ) {
+			r = c == details::iostate::eos_c && v.finish();
+			break;
+		}
+		r = v.feed(&c, 1);
+	}
+	if( offset ) *offset = r ? v.size() : v.offset();
+	return r;
+}
+
+/**
+ * Validates a JSON document in a contiguous buffer
+ */
+template<unsigned Depth = 256>
+bool Validate(const char_t* data, std::size_t size,
+		const limits& lim = limits(), std::size_t* offset = nullptr) noexcept {
+	validator<Depth> v(lim);
+	bool r = v.feed(data, size) && v.finish();
+	if( offset ) *offset = r ? v.size() : v.offset();
+	return r;
+}
+
+}
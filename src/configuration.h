@@ -41,6 +41,12 @@ namespace configuration {
 
 		/// for internal double write controls precision (significant digits)
 		//  static constexpr unsigned write_double_precision = 12;
+
+		/// controls implementation of the sprintf buffer, as temporary_static (per_thread is hosted only)
+		//  static constexpr auto sprintf_buffer_static = temporary_is::per_thread;
+
+		/// size in bytes of the per thread scratch arena for temporaries
+		//  static constexpr unsigned scratch_size = 256;
 	};
 
 	template<typename build>
@@ -53,10 +59,14 @@ namespace configuration {
 		//  static constexpr unsigned temporary_size = 32;
 
 		/// controls implementation of temp buffer, used for reading names
+		/// false, true or cojson::default_config::temporary_is::per_thread (hosted only)
 		//  static constexpr auto temporary_static = false;
 
 		/// sets maximal length of a JSON key length
 		//  static constexpr unsigned max_key_length = 128;
+
+		/// sets maximal nesting depth of skipped values
+		//  static constexpr unsigned skip_depth = 32;
 	  };
 
 	/// If necessary, add Configuration specialization for other targets
@@ -81,6 +81,10 @@ overflow-OBJS     := 034.o
 saturate-OBJS     := 034.o
 
 80.o: FILE-FLAGS := -Wno-missing-field-initializers
+121.o: FILE-FLAGS := -std=c++17
+
+CXX-DEFS := 																	\
+  COJSON_SUITE_SIZE=400														\
 
 OBJS := 																	\
   $(COJSON-OBJS)															\
@@ -98,6 +102,7 @@ CPPFLAGS += 																\
   -ffunction-sections  														\
   -fdata-sections															\
   -std=c++1y  																\
+  -pthread																	\
   -Wno-noexcept-type
 
 CFLAGS += 																	\
@@ -113,6 +118,7 @@ char16-FLAGS += -Wno-format
 char32-FLAGS += -Wno-format
 
 LDFLAGS +=																	\
+  -pthread																	\
   -s						 												\
 
 
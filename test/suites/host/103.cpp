@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 103.cpp - cojson tests, reading from segmented input
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include "test.hpp"
+
+using wrapper::segment;
+using wrapper::segments;
+
+struct Item103 {
+	struct Name {
+		NAME(name)
+		NAME(value)
+		NAME(ratio)
+	};
+	char name[24];
+	long value;
+	double ratio;
+	static const clas<Item103>& structure() noexcept {
+		return O<Item103,
+			P<Item103, Name::name, sizeof(Item103::name), &Item103::name>,
+			P<Item103, Name::value, long, &Item103::value>,
+			P<Item103, Name::ratio, double, &Item103::ratio>
+		>();
+	}
+};
+
+struct Doc103 {
+	struct Name {
+		NAME(ifname)
+		NAME(expires)
+		NAME(items)
+		NAME(flags)
+		NAME(up)
+	};
+	char ifname[40];
+	long expires;
+	Item103 items[3];
+	short flags[4];
+	bool up;
+	static const clas<Doc103>& structure() noexcept {
+		return O<Doc103,
+			P<Doc103, Name::ifname, sizeof(Doc103::ifname), &Doc103::ifname>,
+			P<Doc103, Name::expires, long, &Doc103::expires>,
+			P<Doc103, Name::items, Item103, countof(&Doc103::items),
+				&Doc103::items, Item103::structure>,
+			P<Doc103, Name::flags, short, countof(&Doc103::flags),
+				&Doc103::flags>,
+			P<Doc103, Name::up, bool, &Doc103::up>
+		>();
+	}
+	inline void clear() noexcept {
+		memset(this, 0, sizeof(*this));
+	}
+};
+
+static const char doc103[] =
+	"{ \"ifname\" : \"eth0 \\\"wan\\\" \\u0041\\t uplink\",\n"
+	"  \"expires\": -1234567,\n"
+	"  \"unknown\": { \"skip\": [1, 2, {\"me\": \"too\"}], \"a\": null },\n"
+	"  \"items\": [ {\"name\":\"first\", \"value\": 100, \"ratio\": 0.25},\n"
+	"             {\"name\":\"second item\", \"value\": -200, \"ratio\": 1.5e3},\n"
+	"             {\"name\":\"third\", \"value\": 300, \"ratio\": -0.125} ],\n"
+	"  \"flags\": [1, 22, 333, 4444],\n"
+	"  \"up\" : true\n"
+	"}";
+
+static constexpr unsigned size103 = sizeof(doc103) - 1;
+
+/* writes doc as json into dst */
+static bool write103(const Doc103& doc, char_t* dst, unsigned size) noexcept {
+	buffer out(dst, size);
+	bool r = Doc103::structure().write(doc, out) && out.put(0);
+	return r && out.error() == error_t::noerror;
+}
+
+/* reads doc103 from a contiguous buffer and writes it into dst */
+static bool reference103(char_t* dst, unsigned size) noexcept {
+	Doc103 doc;
+	doc.clear();
+	buffer in(const_cast<char_t*>(doc103), size103);
+	lexer lex(in);
+	return Doc103::structure().read(doc, lex) && write103(doc, dst, size);
+}
+
+/* reads doc103 from a list of segments and matches with expected output */
+static bool match103(const Environment& env, const segment* list,
+		unsigned count, const char_t* expected) noexcept {
+	char_t result[512];
+	Doc103 doc;
+	doc.clear();
+	segments in(list, count);
+	lexer lex(in);
+	bool r = Doc103::structure().read(doc, lex);
+	if( ! r || lex.error() != error_t::noerror || in.count() != size103 ) {
+		env.msg(LVL::normal, "read failed with error %X at %u\n",
+				+lex.error(), in.count());
+		return false;
+	}
+	if( ! write103(doc, result, sizeof(result)) ) return false;
+	if( strcmp(result, expected) != 0 ) {
+		env.msg(LVL::normal, "mismatch\ngot: %s\nexp: %s\n", result, expected);
+		return false;
+	}
+	return true;
+}
+
+/* splits doc103 in segments of fixed size */
+static result_t fixed103(const Environment& env, unsigned length) noexcept {
+	char_t expected[512];
+	segment list[size103];
+	if( ! reference103(expected, sizeof(expected)) ) return bad;
+	unsigned count = 0;
+	for(unsigned i = 0; i < size103; i += length) {
+		list[count].data = doc103 + i;
+		list[count].length = i + length < size103 ? length : size103 - i;
+		++count;
+	}
+	bool r = match103(env, list, count, expected);
+	env.out(r, "%s\n", expected);
+	return combine1(r);
+}
+
+/* splits doc103 at every possible position in two or three segments,
+ * with an empty segment in the middle */
+static result_t every103(const Environment& env, bool empty) noexcept {
+	char_t expected[512];
+	if( ! reference103(expected, sizeof(expected)) ) return bad;
+	for(unsigned i = 0; i <= size103; ++i) {
+		segment list[3] = {
+			{ doc103, i },
+			{ doc103 + i, 0 },
+			{ doc103 + i, size103 - i }
+		};
+		if( ! empty ) list[1] = list[2];
+		if( ! match103(env, list, empty ? 3 : 2, expected) ) {
+			env.msg(LVL::normal, "failed at split %u\n", i);
+			return bad;
+		}
+	}
+	env.out(true, "%s\n", expected);
+	return success;
+}
+
+/* reads a truncated input, expecting a partial result */
+static result_t truncated103(const Environment& env) noexcept {
+	Doc103 doc;
+	doc.clear();
+	segment list[] = { { doc103, 10 }, { doc103 + 10, 30 } };
+	segments in(list);
+	lexer lex(in);
+	bool r = Doc103::structure().read(doc, lex);
+	env.out(true, "%s\n", doc.ifname);
+	return combine1(! r && strncmp(doc.ifname, "eth0 \"wan\"", 10) == 0);
+}
+
+/* a stream with get only, runs are never asked for */
+struct stream103 : details::istream {
+	inline stream103(const char_t* text, unsigned size) noexcept
+	  : text(text), size(size), pos(0) {}
+	bool get(char_t& c) noexcept {
+		if( pos < size ) {
+			c = text[pos++];
+			return true;
+		}
+		c = iostate::eos_c;
+		istream::error(error_t::eof);
+		return false;
+	}
+	const char_t* text;
+	unsigned size;
+	unsigned pos;
+};
+
+static result_t getonly103(const Environment& env) noexcept {
+	constexpr unsigned loops = 2000;
+	static char_t text[1026];
+	char_t expected[512];
+	char_t result[512];
+	if( ! reference103(expected, sizeof(expected)) ) return bad;
+	Doc103 doc;
+	doc.clear();
+	stream103 in(doc103, size103);
+	lexer lex(in);
+	bool r = ! lex.windowed() && Doc103::structure().read(doc, lex) &&
+		write103(doc, result, sizeof(result)) && strcmp(result, expected) == 0;
+	text[0] = text[sizeof(text) - 1] = literal::quotation_mark;
+	memset(text + 1, 'a', sizeof(text) - 2);
+	char_t str[sizeof(text)];
+	env.startclock();
+	for(unsigned i = 0; i < loops && r; ++i) {
+		stream103 src(text, sizeof(text));
+		lexer l(src);
+		r = details::reader<char_t*>::read(str, sizeof(str), l);
+	}
+	long us = env.elapsed();
+	env.out(r, "%s\n", result);
+	env.msg(LVL::verbose, "%u strings of %u read with get in %ld us\n",
+		loops, static_cast<unsigned>(sizeof(text) - 2), us);
+	return combine1(r && strlen(str) == sizeof(text) - 2);
+}
+
+struct Test103 : Test {
+	static Test103 tests[];
+	inline Test103(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test103(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test103 Test103::tests[] = {
+	RUN("segmented input: single segment", {
+		return fixed103(env, size103);										}),
+	RUN("segmented input: one character segments", {
+		return fixed103(env, 1);											}),
+	RUN("segmented input: three character segments", {
+		return fixed103(env, 3);											}),
+	RUN("segmented input: 64 character segments", {
+		return fixed103(env, 64);											}),
+	RUN("segmented input: split at every position", {
+		return every103(env, false);										}),
+	RUN("segmented input: empty segment at every position", {
+		return every103(env, true);											}),
+	RUN("segmented input: truncated input", {
+		return truncated103(env);											}),
+	RUN("segmented input: get only stream", {
+		return getonly103(env);												}),
+};
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 104.cpp - cojson tests, streaming through a SPSC ring buffer
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include <thread>
+#include "cojson_ring.hpp"
+#include "test.hpp"
+
+namespace waiting = wrapper::waiting;
+using wrapper::ring;
+
+struct Data104 {
+	struct Name {
+		NAME(id)
+		NAME(values)
+	};
+	long id;
+	long values[2048];
+	static const clas<Data104>& structure() noexcept {
+		return O<Data104,
+			P<Data104, Name::id, long, &Data104::id>,
+			P<Data104, Name::values, long, countof(&Data104::values),
+				&Data104::values>
+		>();
+	}
+};
+
+static Data104 src104, dst104;
+
+/* produces Data104 as JSON in one thread and consumes it in another */
+template<cojson::size_t N, class W>
+static result_t json104(const Environment& env) noexcept {
+	ring<N, W> pipe;
+	for(unsigned i = 0; i < countof(&Data104::values); ++i)
+		src104.values[i] = (i * 7919L) ^ -(long)(i & 1);
+	src104.id = N;
+	memset(&dst104, 0, sizeof(dst104));
+	bool written = false;
+	std::thread producer([&pipe, &written]() noexcept {
+		written = Data104::structure().write(src104, pipe.output());
+		pipe.output().close();
+	});
+	lexer lex(pipe.input());
+	bool read = Data104::structure().read(dst104, lex);
+	pipe.input().close();
+	producer.join();
+	bool match = memcmp(&src104, &dst104, sizeof(src104)) == 0;
+	if( ! match ) env.msg(LVL::normal, "data mismatch\n");
+	env.out(true, "%ld\n", dst104.id);
+	return combine1(written && read && match);
+}
+
+/* pumps raw characters through the ring and reports the throughput */
+template<cojson::size_t N, class W>
+static result_t raw104(const Environment& env, const char* name) noexcept {
+	static constexpr unsigned long total = 1UL << 18;
+	ring<N, W> pipe;
+	unsigned long sum = 0, count = 0;
+	env.startclock();
+	std::thread producer([&pipe]() noexcept {
+		for(unsigned long i = 0; i < total; ++i)
+			if( ! pipe.output().put(static_cast<char_t>(i & 0x7F)) ) break;
+		pipe.output().close();
+	});
+	cojson::size_t n;
+	while( const char_t* p = pipe.input().window(n) ) {
+		for(cojson::size_t i = 0; i < n; ++i) sum += p[i];
+		count += n;
+		pipe.input().advance(n);
+	}
+	producer.join();
+	long us = env.elapsed();
+	unsigned long expected = (total / 128) * (127 * 128 / 2);
+	env.msg(LVL::verbose, "%s: %lu chars in %ld us, %ld MB/s\n", name, count,
+		us, us ? static_cast<long>(count * sizeof(char_t) / us) : 0L);
+	env.out(true, "%lu\n", count);
+	return combine1(count == total && sum == expected);
+}
+
+/* consumer abandons the stream before the producer is done */
+static result_t abandon104(const Environment& env) noexcept {
+	ring<64, waiting::block> pipe;
+	bool written = true;
+	std::thread producer([&pipe, &written]() noexcept {
+		for(unsigned i = 0; i < 1000 && written; ++i)
+			written = pipe.output().put('x');
+		pipe.output().close();
+	});
+	char_t c;
+	for(unsigned i = 0; i < 10; ++i) pipe.input().get(c);
+	pipe.input().close();
+	producer.join();
+	env.out(true, "%s\n", written ? "written" : "abandoned");
+	return combine1(! written &&
+		pipe.output().error() == details::error_t::eof);
+}
+
+/* reading past the end of a closed stream */
+static result_t eos104(const Environment& env) noexcept {
+	ring<16, waiting::yield> pipe;
+	long value = 0;
+	const char_t text[] = "12345";
+	for(const char_t* p = text; *p; ++p) pipe.output().put(*p);
+	pipe.output().close();
+	lexer lex(pipe.input());
+	bool r = details::reader<long>::read(value, lex);
+	env.out(true, "%ld\n", value);
+	return combine1(r && value == 12345 &&
+		pipe.input().error() == details::error_t::eof);
+}
+
+/* bulk writes wrap around a ring smaller than a single write */
+static result_t bulk104(const Environment& env) noexcept {
+	static constexpr unsigned total = 5000, run = 37;
+	ring<16, waiting::block> pipe;
+	bool written = true;
+	std::thread producer([&pipe, &written]() noexcept {
+		char_t text[run];
+		for(unsigned i = 0; i < total && written; i += run) {
+			unsigned n = total - i < run ? total - i : run;
+			for(unsigned j = 0; j < n; ++j)
+				text[j] = static_cast<char_t>('a' + (i + j) % 26);
+			written = pipe.output().write(text, n);
+		}
+		pipe.output().close();
+	});
+	unsigned count = 0, wrong = 0;
+	char_t c;
+	while( pipe.input().get(c) ) {
+		if( c != static_cast<char_t>('a' + count % 26) ) ++wrong;
+		++count;
+	}
+	producer.join();
+	env.out(true, "%u %u\n", count, wrong);
+	return combine1(written && count == total && wrong == 0);
+}
+
+/* a producer waiting for a reply flushes its message first */
+static result_t flush104(const Environment& env) noexcept {
+	ring<256, waiting::block> request, reply;
+	long answer = 0;
+	std::thread server([&request, &reply]() noexcept {
+		char_t c;
+		long value = 0;
+		while( request.input().get(c) && c != ';' ) value = value * 10 + c - '0';
+		reply.output().put(static_cast<char_t>('0' + value % 10));
+		reply.output().close();
+	});
+	for(const char_t* p = "1234;"; *p; ++p) request.output().put(*p);
+	request.output().flush();
+	char_t c = 0;
+	bool r = reply.input().get(c);
+	request.output().close();
+	server.join();
+	answer = c - '0';
+	env.out(true, "%ld\n", answer);
+	return combine1(r && answer == 4);
+}
+
+struct Test104 : Test {
+	static Test104 tests[];
+	inline Test104(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test104(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test104 Test104::tests[] = {
+	RUN("ring: json through a tiny ring, yield", {
+		return (json104<16, waiting::yield>(env));							}),
+	RUN("ring: json through a ring, yield", {
+		return (json104<256, waiting::yield>(env));							}),
+	RUN("ring: json through a ring, block", {
+		return (json104<256, waiting::block>(env));							}),
+	RUN("ring: json through a ring, spin", {
+		return (json104<4096, waiting::spin>(env));							}),
+	RUN("ring: raw throughput, spin", {
+		return (raw104<4096, waiting::spin>(env, "spin"));					}),
+	RUN("ring: raw throughput, yield", {
+		return (raw104<4096, waiting::yield>(env, "yield"));					}),
+	RUN("ring: raw throughput, block", {
+		return (raw104<4096, waiting::block>(env, "block"));					}),
+	RUN("ring: consumer abandons the stream", {
+		return abandon104(env);												}),
+	RUN("ring: reading past end of stream", {
+		return eos104(env);													}),
+	RUN("ring: bulk writes through a tiny ring", {
+		return bulk104(env);												}),
+	RUN("ring: flushing a message before waiting for a reply", {
+		return flush104(env);												}),
+};
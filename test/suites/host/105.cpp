@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 105.cpp - cojson tests, asynchronous bulk ingestion of files
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include "cojson_ingest.hpp"
+#include "bench.hpp"
+
+using ingest::pipeline;
+using ingest::status;
+
+/* a directory of generated 080-style documents */
+class Files105 {
+public:
+	static constexpr unsigned count = 256;
+	static const Files105& instance() noexcept {
+		static Files105 files;
+		return files;
+	}
+	const char* const* paths() const noexcept { return list; }
+	bool good() const noexcept { return ok; }
+	~Files105() noexcept {
+		for(unsigned i = 0; i < count; ++i) remove(names[i]);
+		rmdir(dir);
+	}
+private:
+	Files105() noexcept {
+		strcpy(dir, "/tmp/cojson105XXXXXX");
+		ok = mkdtemp(dir) != nullptr;
+		for(unsigned i = 0; i < count; ++i) {
+			snprintf(names[i], sizeof(names[i]), "%s/%04u.json", dir, i);
+			list[i] = names[i];
+			ok = ok && generate(names[i], i);
+		}
+	}
+	static bool generate(const char* name, unsigned i) noexcept {
+		static Config config;
+		static char_t text[4096];
+		memset(&config, 0, sizeof(config));
+		strcpy(config.wan.proto, "dhcp");
+		strcpy(config.wan.ifname, "br-wan");
+		config.wan.ipaddr = ip4_t{{192, 168, 159, static_cast<unsigned char>(i)}};
+		config.wan.expires = -1;
+		config.uptime = 10176796L + i;
+		config.memtotal = i;
+		strcpy(config.localtime, "Tue Sep  8 06:21:31 2015");
+		strcpy(config.wifinets[0].device, "radio0");
+		strcpy(config.wifinets[0].networks[0].ssid, "json");
+		config.loadavg[0] = 0.00292969;
+		buffer out(text, sizeof(text));
+		if( ! Config::structure().write(config, out) ) return false;
+		FILE* f = fopen(name, "w");
+		if( f == nullptr ) return false;
+		bool r = fwrite(text, 1, out.count(), f) == out.count();
+		return fclose(f) == 0 && r;
+	}
+	char dir[32];
+	char names[count][48];
+	const char* list[count];
+	bool ok;
+};
+
+/* checks a document bound by the pipeline */
+static inline bool check105(std::size_t index, const Config& c) noexcept {
+	return c.memtotal == static_cast<long>(index) &&
+		c.wan.ipaddr.byte[3] == (index & 0xFF) &&
+		strcmp(c.wifinets[0].networks[0].ssid, "json") == 0;
+}
+
+/* ingests all files, returns number of valid documents */
+static unsigned run105(const Files105& files, bool uring, unsigned workers,
+		bool& async) noexcept {
+	std::atomic<unsigned> valid(0);
+	pipeline<Config> ingestion(Config::structure(), workers, 16, uring);
+	ingestion.run(files.paths(), Files105::count,
+		[&valid](std::size_t index, const Config& c, const status& s) {
+			if( s.read && s.error == 0 && check105(index, c) ) ++valid;
+		});
+	async = ingestion.asynchronous();
+	return valid;
+}
+
+/* reads and binds all files in a synchronous loop */
+static unsigned sync105(const Files105& files) noexcept {
+	static char_t text[4096];
+	static Config config;
+	unsigned valid = 0;
+	for(unsigned i = 0; i < Files105::count; ++i) {
+		FILE* f = fopen(files.paths()[i], "r");
+		if( f == nullptr ) continue;
+		unsigned n = fread(text, 1, sizeof(text) - 1, f);
+		fclose(f);
+		memset(&config, 0, sizeof(config));
+		buffer in(text, n);
+		lexer lex(in);
+		if( Config::structure().read(config, lex) && check105(i, config) )
+			++valid;
+	}
+	return valid;
+}
+
+/* io_uring may be absent or disabled by a sandbox */
+static bool uring_supported() noexcept {
+	static const bool supported = ingest::uring(1).valid();
+	return supported;
+}
+
+static result_t ingest105(const Environment& env, bool uring) noexcept {
+	const Files105& files = Files105::instance();
+	if( ! files.good() ) return bad;
+	bool async = false;
+	unsigned valid = run105(files, uring, 0, async);
+	env.msg(LVL::verbose, "%u of %u documents, %s\n", valid, Files105::count,
+		async ? "io_uring" : "pread");
+	env.out(true, "%u\n", valid);
+	return combine1(valid == Files105::count && (async || ! uring ||
+		! uring_supported()));
+}
+
+static result_t failures105(const Environment& env) noexcept {
+	const Files105& files = Files105::instance();
+	if( ! files.good() ) return bad;
+	static const char* const paths[] = {
+		files.paths()[0], "/nonexistent/105.json", "/dev/null", "/proc/self/cmdline"
+	};
+	status result[countof(paths)];
+	std::size_t good = pipeline<Config>(Config::structure(), 2, 2).run(
+		paths, countof(paths),
+		[&result](std::size_t index, const Config&, const status& s) {
+			result[index] = s;
+		});
+	for(unsigned i = 0; i < countof(paths); ++i)
+		env.msg(LVL::verbose, "%s: errno %d, size %u, read %d, error %X\n",
+			paths[i], result[i].error, static_cast<unsigned>(result[i].size),
+			result[i].read, +result[i].parse);
+	env.out(true, "%u\n", static_cast<unsigned>(good));
+	return combine1(good == 1 && result[0].read &&
+		result[1].error == ENOENT && ! result[1].read &&
+		result[2].error == 0 && result[2].parse == details::error_t::eof &&
+		! result[3].read);
+}
+
+static result_t bench105(const Environment& env) noexcept {
+	const Files105& files = Files105::instance();
+	if( ! files.good() ) return bad;
+	bool async = false;
+	env.startclock();
+	unsigned sync = sync105(files);
+	long t1 = env.elapsed();
+	env.startclock();
+	unsigned pipe = run105(files, true, 0, async);
+	long t2 = env.elapsed();
+	env.msg(LVL::verbose, "synchronous: %ld files/s\n",
+		t1 ? Files105::count * 1000000L / t1 : 0L);
+	env.msg(LVL::verbose, "pipeline (%s): %ld files/s\n",
+		async ? "io_uring" : "pread", t2 ? Files105::count * 1000000L / t2 : 0L);
+	env.out(true, "%u %u\n", sync, pipe);
+	return combine1(sync == Files105::count && pipe == Files105::count);
+}
+
+struct Test105 : Test {
+	static Test105 tests[];
+	inline Test105(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test105(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test105 Test105::tests[] = {
+	RUN("ingestion: io_uring pipeline", {
+		return ingest105(env, true);										}),
+	RUN("ingestion: pread fallback", {
+		return ingest105(env, false);										}),
+	RUN("ingestion: missing, empty and malformed files", {
+		return failures105(env);											}),
+	RUN("ingestion: files/s versus synchronous loop", {
+		return bench105(env);												}),
+};
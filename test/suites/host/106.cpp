@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 106.cpp - cojson tests, tee and digest output filters
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include "test.hpp"
+#include "cojson_filters.hpp"
+
+using wrapper::tee;
+using wrapper::digest;
+namespace hash = wrapper::hash;
+
+struct Item106 {
+	struct Name {
+		NAME(name)
+		NAME(note)
+		NAME(value)
+	};
+	char name[32];
+	char note[64];
+	long value;
+	static const clas<Item106>& structure() noexcept {
+		return O<Item106,
+			P<Item106, Name::name, sizeof(Item106::name), &Item106::name>,
+			P<Item106, Name::note, sizeof(Item106::note), &Item106::note>,
+			P<Item106, Name::value, long, &Item106::value>
+		>();
+	}
+};
+
+static const Item106 item106 = {
+	"plain name", "quoted \"note\"\twith\\escapes\n", -123456789L
+};
+
+/* writes item106 into a single buffer */
+static unsigned reference106(char_t* dst, unsigned size) noexcept {
+	buffer out(dst, size);
+	if( ! Item106::structure().write(item106, out) ) return 0;
+	return out.count();
+}
+
+template<class H>
+static typename H::type hash106(const char_t* str, unsigned len) noexcept {
+	H h;
+	for(unsigned i = 0; i < len; ++i) h.update(static_cast<uint8_t>(str[i]));
+	return h.value();
+}
+
+/* known test vectors, hashed via put and via bulk write */
+static result_t vectors106(const Environment& env) noexcept {
+	static const struct {
+		const char_t* text;
+		uint32_t crc;
+		uint64_t xxh;
+	} vectors[] = {
+		{ "", 0, 0xEF46DB3751D8E999ULL },
+		{ "abc", 0x352441C2, 0x44BC2CF5AD770999ULL },
+		{ "123456789", 0xCBF43926, 0x8CB841DB40E6AE83ULL },
+		{ "The quick brown fox jumps over the lazy dog",
+				0x414FA339, 0x0B242D361FDA71BCULL },
+	};
+	bool r = true;
+	for(const auto& v : vectors) {
+		digest<hash::crc32> crc;
+		digest<hash::xxh64> xxh;
+		crc.puts(v.text);
+		xxh.write(v.text, strlen(v.text));
+		env.out(true, "%08X %016llX\n", crc.value(),
+			static_cast<unsigned long long>(xxh.value()));
+		r = r && crc.value() == v.crc && xxh.value() == v.xxh;
+	}
+	return combine1(r);
+}
+
+/* one serialization to two sinks and a digest */
+static result_t tee106(const Environment& env) noexcept {
+	char_t expected[256], first[256], second[256];
+	unsigned size = reference106(expected, sizeof(expected));
+	memset(first, 0, sizeof(first));
+	memset(second, 0, sizeof(second));
+	buffer out1(first, sizeof(first)), out2(second, sizeof(second));
+	digest<hash::crc32> crc;
+	tee<3> out(out1, out2, crc);
+	bool r = size && Item106::structure().write(item106, out);
+	env.out(true, "%s\n", first);
+	return combine1(r && out1.count() == size && out2.count() == size &&
+		memcmp(first, expected, size) == 0 &&
+		memcmp(second, expected, size) == 0 &&
+		crc.value() == hash106<hash::crc32>(expected, size));
+}
+
+/* digest forwarding to the next stream */
+static result_t forward106(const Environment& env) noexcept {
+	char_t expected[256], result[256];
+	unsigned size = reference106(expected, sizeof(expected));
+	memset(result, 0, sizeof(result));
+	buffer next(result, sizeof(result));
+	digest<hash::xxh64> out(next);
+	bool r = size && Item106::structure().write(item106, out);
+	env.out(true, "%s\n", result);
+	return combine1(r && next.count() == size &&
+		memcmp(result, expected, size) == 0 &&
+		out.value() == hash106<hash::xxh64>(expected, size));
+}
+
+/* a failing sink does not stop the other one */
+static result_t failing106(const Environment& env) noexcept {
+	char_t expected[256], small[16], large[256];
+	unsigned size = reference106(expected, sizeof(expected));
+	memset(large, 0, sizeof(large));
+	buffer out1(small, sizeof(small)), out2(large, sizeof(large));
+	tee<2> out(out1, out2);
+	bool r = Item106::structure().write(item106, out);
+	env.out(true, "%s\n", large);
+	return combine1(! r && out.error() == out1.error() &&
+		out.error() != details::error_t::noerror &&
+		out2.count() < size && memcmp(large, expected, out2.count()) == 0);
+}
+
+struct Test106 : Test {
+	static Test106 tests[];
+	inline Test106(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test106(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test106 Test106::tests[] = {
+	RUN("filters: crc32 and xxh64 test vectors", {
+		return vectors106(env);												}),
+	RUN("filters: tee to two buffers and a digest", {
+		return tee106(env);													}),
+	RUN("filters: digest forwarding to a buffer", {
+		return forward106(env);												}),
+	RUN("filters: tee with a failing sink", {
+		return failing106(env);												}),
+};
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 107.cpp - cojson tests, HTTP chunked transfer encoding output
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <thread>
+#include "cojson_chunked.hpp"
+#include "test.hpp"
+
+using wrapper::chunked;
+
+struct Item107 {
+	struct Name {
+		NAME(name)
+		NAME(note)
+		NAME(values)
+	};
+	char name[32];
+	char note[64];
+	long values[40];
+	static const clas<Item107>& structure() noexcept {
+		return O<Item107,
+			P<Item107, Name::name, sizeof(Item107::name), &Item107::name>,
+			P<Item107, Name::note, sizeof(Item107::note), &Item107::note>,
+			P<Item107, Name::values, long, countof(&Item107::values),
+				&Item107::values>
+		>();
+	}
+};
+
+static Item107 item107 = { "chunked", "with \"escapes\"\tand\\more", {} };
+
+/* sends a framed chunk to the socket */
+static bool send107(const char_t* data, cojson::size_t size, void* ctx) noexcept {
+	int fd = *static_cast<int*>(ctx);
+	while( size ) {
+		ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+		if( n <= 0 ) return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+/* appends a framed chunk to a string */
+static bool append107(const char_t* data, cojson::size_t size, void* ctx) noexcept {
+	strncat(static_cast<char*>(ctx), data, size);
+	return true;
+}
+
+/* decodes chunked body, returns body length or -1 on framing errors */
+static int decode107(const char* src, unsigned len, char* dst, unsigned size,
+		unsigned& chunks, unsigned& largest) noexcept {
+	unsigned pos = 0, out = 0;
+	chunks = largest = 0;
+	while( pos < len ) {
+		char* end;
+		unsigned long n = strtoul(src + pos, &end, 16);
+		pos = end - src;
+		if( pos + 2 > len || src[pos] != '\r' || src[pos+1] != '\n' ) return -1;
+		pos += 2;
+		if( n == 0 )
+			return pos + 2 == len && src[pos] == '\r' && src[pos+1] == '\n'
+				? static_cast<int>(out) : -1;
+		if( pos + n + 2 > len || out + n >= size ) return -1;
+		memcpy(dst + out, src + pos, n);
+		out += n;
+		pos += n;
+		if( src[pos] != '\r' || src[pos+1] != '\n' ) return -1;
+		pos += 2;
+		++chunks;
+		if( n > largest ) largest = n;
+	}
+	return -1;
+}
+
+/* writes item107 via chunked stream to a socket, a client thread decodes */
+static result_t socket107(const Environment& env) noexcept {
+	static char_t expected[1024], received[4096], body[1024];
+	for(unsigned i = 0; i < countof(&Item107::values); ++i)
+		item107.values[i] = i * 1000003L;
+	buffer ref(expected, sizeof(expected));
+	if( ! Item107::structure().write(item107, ref) ) return bad;
+	int fds[2];
+	if( socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0 ) return bad;
+	unsigned len = 0;
+	std::thread client([&fds, &len]() noexcept {
+		ssize_t n;
+		while( (n = read(fds[1], received + len, sizeof(received) - len)) > 0 )
+			len += n;
+	});
+	chunked<64> out(send107, &fds[0]);
+	bool r = Item107::structure().write(item107, out) && out.finish();
+	shutdown(fds[0], SHUT_WR);
+	client.join();
+	close(fds[0]);
+	close(fds[1]);
+	unsigned chunks, largest;
+	int size = decode107(received, len, body, sizeof(body), chunks, largest);
+	env.msg(LVL::verbose, "%u chunks, largest %u, body %d of %u\n",
+		chunks, largest, size, ref.count());
+	env.out(true, "%.*s\n", size > 0 ? size : 0, body);
+	return combine1(r && size == static_cast<int>(ref.count()) &&
+		largest == 64 && out.count() == ref.count() &&
+		memcmp(body, expected, size) == 0);
+}
+
+/* exact framing of a small output */
+static result_t framing107(const Environment& env) noexcept {
+	char result[64] = {};
+	chunked<2> out(append107, result);
+	bool r = out.puts("abc") && out.finish() && out.finish();
+	env.out(true, "%s\n", result);
+	return combine1(r && strcmp(result, "2\r\nab\r\n1\r\nc\r\n0\r\n\r\n") == 0);
+}
+
+/* no output, flush on an exactly full block and an explicit flush */
+static result_t boundary107(const Environment& env) noexcept {
+	char empty[16] = {}, full[64] = {};
+	chunked<4> none(append107, empty);
+	chunked<4> out(append107, full);
+	bool r = none.finish() &&
+		out.write("abcd", 4) && out.flush() && out.flush() &&
+		out.write("efgh", 4) && out.finish();
+	env.out(true, "%s%s\n", empty, full);
+	return combine1(r && strcmp(empty, "0\r\n\r\n") == 0 &&
+		strcmp(full, "4\r\nabcd\r\n4\r\nefgh\r\n0\r\n\r\n") == 0);
+}
+
+/* hand-off failure propagates to the writer */
+static result_t failure107(const Environment& env) noexcept {
+	chunked<16> out([](const char_t*, cojson::size_t, void*) noexcept {
+		return false; });
+	bool r = Item107::structure().write(item107, out);
+	env.out(true, "%s\n", r ? "written" : "failed");
+	return combine1(! r && out.error() == details::error_t::eof);
+}
+
+struct Test107 : Test {
+	static Test107 tests[];
+	inline Test107(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test107(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test107 Test107::tests[] = {
+	RUN("chunked: object to a socket, decoded by a client", {
+		return socket107(env);												}),
+	RUN("chunked: framing of a small output", {
+		return framing107(env);												}),
+	RUN("chunked: empty body and full block boundary", {
+		return boundary107(env);											}),
+	RUN("chunked: hand-off failure", {
+		return failure107(env);												}),
+};
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 108.cpp - cojson tests, NDJSON records reader and writer
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "test.hpp"
+#include "cojson_ndjson.hpp"
+
+struct Record108 {
+	struct Name {
+		NAME(id)
+		NAME(name)
+		NAME(tags)
+	};
+	long id;
+	char name[16];
+	short tags[3];
+	static const clas<Record108>& structure() noexcept {
+		return O<Record108,
+			P<Record108, Name::id, long, &Record108::id>,
+			P<Record108, Name::name, sizeof(Record108::name), &Record108::name>,
+			P<Record108, Name::tags, short, countof(&Record108::tags),
+				&Record108::tags>
+		>();
+	}
+	inline void clear() noexcept {
+		memset(this, 0, sizeof(*this));
+	}
+};
+
+/* reads all records from text, writes "line:id;" or "line:error;" to log */
+static unsigned read108(const char_t* text, char* log, unsigned size) noexcept {
+	Record108 rec;
+	rec.clear();
+	buffer in(const_cast<char_t*>(text), strlen(text));
+	ndjson::reader<Record108> records(Record108::structure(), in);
+	log[0] = 0;
+	return records.each(rec, [log, size](Record108& r, error_t e,
+			cojson::size_t line) noexcept {
+		unsigned len = strlen(log);
+		if( e == error_t::noerror )
+			snprintf(log + len, size - len, "%u:%ld;", line, r.id);
+		else
+			snprintf(log + len, size - len, "%u:E%X;", line, +e);
+		r.clear();
+	});
+}
+
+static result_t match108(const Environment& env, const char_t* text,
+		const char* expected, unsigned good) noexcept {
+	char log[256];
+	unsigned n = read108(text, log, sizeof(log));
+	env.out(true, "%s\n", log);
+	if( strcmp(log, expected) != 0 )
+		env.msg(LVL::normal, "got %s\nexp %s\n", log, expected);
+	return combine1(n == good && strcmp(log, expected) == 0);
+}
+
+/* records written by the writer are read back */
+static result_t roundtrip108(const Environment& env) noexcept {
+	char_t text[1024];
+	buffer out(text, sizeof(text));
+	ndjson::writer<Record108> records(Record108::structure(), out);
+	Record108 rec;
+	bool r = true;
+	for(long i = 1; i <= 10 && r; ++i) {
+		rec.clear();
+		rec.id = i * 101;
+		snprintf(rec.name, sizeof(rec.name), "name %ld", i);
+		rec.tags[i % 3] = static_cast<short>(i);
+		r = records.write(rec);
+	}
+	r = r && out.put(0);
+	Record108 back;
+	back.clear();
+	buffer in(text, out.count() - 1);
+	ndjson::reader<Record108> input(Record108::structure(), in);
+	long sum = 0;
+	unsigned n = 0;
+	while( input.next(back) ) {
+		if( ! input.good() ) return bad;
+		sum += back.id;
+		++n;
+	}
+	env.out(true, "%s", text);
+	return combine1(r && records.count() == 10 && n == 10 && sum == 5555 &&
+		strcmp(back.name, "name 10") == 0 && back.tags[1] == 10);
+}
+
+struct Test108 : Test {
+	static Test108 tests[];
+	inline Test108(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test108(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test108 Test108::tests[] = {
+	RUN("ndjson: plain records", {
+		return match108(env,
+			"{\"id\":1,\"name\":\"one\"}\n"
+			"{\"id\":2,\"tags\":[1,2,3]}\n"
+			"{\"id\":3}\n",
+			"1:1;2:2;3:3;", 3);												}),
+	RUN("ndjson: empty lines, whitespace and CRLF", {
+		return match108(env,
+			"\n  \n{\"id\":1}\r\n\t{ \"id\" : 2 }  \r\n\n",
+			"3:1;4:2;", 2);													}),
+	RUN("ndjson: malformed records", {
+		return match108(env,
+			"{\"id\":1}\n"
+			"{\"id\":2,\n"
+			"{\"id\":3}\n"
+			"{\"id\":4} trailing\n"
+			"[5]\n"
+			"{\"id\":6}",
+			"1:1;2:E20;3:3;4:E20;5:E2;6:6;", 3);								}),
+	RUN("ndjson: truncated last record", {
+		return match108(env,
+			"{\"id\":1}\n{\"id\":", "1:1;2:E20;", 1);							}),
+	RUN("ndjson: truncated unknown values skipped over windows", {
+		return match108(env,
+			"{\"id\":1,\"extra\":[1,{\"a\":\"b\n"
+			"{\"id\":2,\"extra\":\"text\"}\n"
+			"{\"id\":3,\"extra\":{\"deep\":[[\n"
+			"{\"id\":4}\n",
+			"1:E20;2:2;3:E20;4:4;", 2);										}),
+	RUN("ndjson: long unknown strings end at the newline", {
+		return match108(env,
+			"{\"id\":1,\"note\":\"0123456789abcdef0123456789abcdef\n"
+			"{\"id\":2,\"name\":\"two\"}\n",
+			"1:E20;2:2;", 1);												}),
+	RUN("ndjson: writer and reader round trip", {
+		return roundtrip108(env);											}),
+};
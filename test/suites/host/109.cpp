@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 109.cpp - cojson tests, parallel NDJSON parsing
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "cojson_parallel.hpp"
+#include "starve.hpp"
+#include "test.hpp"
+
+struct Record109 {
+	struct Name {
+		NAME(id)
+		NAME(device)
+		NAME(level)
+		NAME(values)
+	};
+	long id;
+	char device[16];
+	double level;
+	short values[4];
+	static const clas<Record109>& structure() noexcept {
+		return O<Record109,
+			P<Record109, Name::id, long, &Record109::id>,
+			P<Record109, Name::device, sizeof(Record109::device),
+				&Record109::device>,
+			P<Record109, Name::level, double, &Record109::level>,
+			P<Record109, Name::values, short, countof(&Record109::values),
+				&Record109::values>
+		>();
+	}
+};
+
+static constexpr unsigned count109 = 20000;
+static constexpr unsigned broken109 = 7;	/* every 7th record is malformed */
+
+/* generates NDJSON text, optionally with malformed records */
+static const std::string& text109(bool malformed) noexcept {
+	static std::string text[2];
+	std::string& t = text[malformed];
+	if( ! t.empty() ) return t;
+	char line[128];
+	for(unsigned i = 0; i < count109; ++i) {
+		if( malformed && i % broken109 == 3 )
+			/* truncated known and unknown values must not run into next line */
+			snprintf(line, sizeof(line), i & 1 ? "{\"id\":%u,\"device\":\"dev\n"
+				: "{\"id\":%u,\"extra\":[1,{\"a\":\"b\n", i);
+		else
+			snprintf(line, sizeof(line), "{\"id\":%u,\"device\":\"dev%u\","
+				"\"level\":%u.5,\"values\":[%u,%u,%u,%u]}\n",
+				i, i % 100, i % 10, i & 7, i & 15, i & 31, i & 63);
+		t += line;
+	}
+	return t;
+}
+
+static inline bool check109(const Record109& r) noexcept {
+	char name[16];
+	snprintf(name, sizeof(name), "dev%ld", r.id % 100);
+	return strcmp(r.device, name) == 0 && r.level == r.id % 10 + 0.5 &&
+		r.values[0] == (r.id & 7) && r.values[3] == (r.id & 63);
+}
+
+/* parses with given number of threads, checks order and content */
+static result_t run109(const Environment& env, unsigned threads,
+		std::size_t chunk, bool malformed) noexcept {
+	const std::string& text = text109(malformed);
+	std::vector<Record109> records;
+	parallel::ndjson<Record109> parser(Record109::structure(), threads, chunk);
+	bool r = parser.read(text.data(), text.size(), records);
+	unsigned expected = count109;
+	if( malformed ) expected -= (count109 + broken109 - 4) / broken109;
+	bool ordered = records.size() == expected;
+	long prev = -1;
+	for(const auto& rec : records) {
+		ordered = ordered && rec.id > prev && check109(rec);
+		prev = rec.id;
+	}
+	env.out(true, "%u records, %u failed\n",
+		static_cast<unsigned>(records.size()),
+		static_cast<unsigned>(parser.failed()));
+	return combine1(r != malformed && ordered &&
+		parser.failed() == count109 - expected);
+}
+
+/* reports scaling from one to N threads */
+static result_t scaling109(const Environment& env) noexcept {
+	const std::string& text = text109(false);
+	unsigned max = std::thread::hardware_concurrency();
+	if( max < 4 ) max = 4;
+	bool r = true;
+	for(unsigned threads = 1; threads <= max; threads *= 2) {
+		std::vector<Record109> records;
+		records.reserve(count109);
+		parallel::ndjson<Record109> parser(Record109::structure(),
+			threads, 64 << 10);
+		env.startclock();
+		r = parser.read(text.data(), text.size(), records) && r;
+		long us = env.elapsed();
+		env.msg(LVL::verbose, "%2u threads: %6ld us, %ld MB/s\n", threads, us,
+			us ? static_cast<long>(text.size() / us) : 0L);
+		r = r && records.size() == count109;
+	}
+	env.out(true, "%u\n", count109);
+	return combine1(r);
+}
+
+/* one of three threads starts, the caller parses the rest of chunks */
+static result_t starved109(const Environment& env) noexcept {
+	const std::string& all = text109(false);
+	std::string text(all, 0, all.find("{\"id\":300,"));
+	std::vector<Record109> records;
+	records.reserve(300);
+	parallel::ndjson<Record109> parser(Record109::structure(), 4, 256);
+	bool r;
+	{
+		test::starve limit(1);
+		r = limit.good() && parser.read(text.data(), text.size(), records);
+	}
+	for(unsigned i = 0; r && i < records.size(); ++i)
+		r = records[i].id == i && check109(records[i]);
+	env.out(true, "%u records\n", static_cast<unsigned>(records.size()));
+	return combine1(r && records.size() == 300);
+}
+
+struct Test109 : Test {
+	static Test109 tests[];
+	inline Test109(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test109(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test109 Test109::tests[] = {
+	RUN("parallel ndjson: single thread", {
+		return run109(env, 1, 1 << 20, false);								}),
+	RUN("parallel ndjson: four threads, small chunks", {
+		return run109(env, 4, 4096, false);									}),
+	RUN("parallel ndjson: tiny chunks", {
+		return run109(env, 3, 1, false);									}),
+	RUN("parallel ndjson: malformed records", {
+		return run109(env, 4, 1000, true);									}),
+	RUN("parallel ndjson: threads fail to start", {
+		return starved109(env);												}),
+	RUN("parallel ndjson: scaling from one to N threads", {
+		return scaling109(env);												}),
+};
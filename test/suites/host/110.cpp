@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 110.cpp - cojson tests, parallel parsing of a large top-level array
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include "cojson_parallel.hpp"
+#include "cojson_insitu.hpp"
+#include "starve.hpp"
+#include "test.hpp"
+
+struct Element110 {
+	struct Name {
+		NAME(id)
+		NAME(label)
+		NAME(values)
+	};
+	long id;
+	char label[24];
+	short values[4];
+	static const clas<Element110>& structure() noexcept {
+		return O<Element110,
+			P<Element110, Name::id, long, &Element110::id>,
+			P<Element110, Name::label, sizeof(Element110::label),
+				&Element110::label>,
+			P<Element110, Name::values, short, countof(&Element110::values),
+				&Element110::values>
+		>();
+	}
+};
+
+static constexpr unsigned count110 = 20000;
+static constexpr unsigned heavy110 = 5000;	/* elements with a large payload */
+
+/* generates an array; elements of the first quarter carry large unknown
+ * members, strings contain structural characters and escapes		*/
+static const std::string& text110() noexcept {
+	static std::string text;
+	if( ! text.empty() ) return text;
+	char item[160];
+	text = " [\n";
+	for(unsigned i = 0; i < count110; ++i) {
+		snprintf(item, sizeof(item), "%s{\"id\":%u,\"label\":\"[%u,{\\\"}\\\\\","
+			"\"values\":[%u,%u,%u,%u]", i ? ",\n" : "", i, i % 100,
+			i & 7, i & 15, i & 31, i & 63);
+		text += item;
+		if( i < heavy110 ) {
+			text += ",\"payload\":[";
+			for(unsigned j = 0; j < 40; ++j)
+				text += j ? ",{\"x\":\"],}\",\"y\":[1,2,3]}" : "{}";
+			text += "]";
+		}
+		text += "}";
+	}
+	text += "\n] ";
+	return text;
+}
+
+static inline bool check110(const Element110& e, long id) noexcept {
+	char label[24];
+	snprintf(label, sizeof(label), "[%ld,{\"}\\", id % 100);
+	return e.id == id && strcmp(e.label, label) == 0 &&
+		e.values[0] == (id & 7) && e.values[3] == (id & 63);
+}
+
+/* parses the generated array, checks every element in place */
+static result_t run110(const Environment& env, unsigned threads,
+		std::size_t batch) noexcept {
+	const std::string& text = text110();
+	std::vector<Element110> elements(3);
+	parallel::array<Element110> parser(Element110::structure(), threads, batch);
+	bool r = parser.read(text.data(), text.size(), elements);
+	bool good = elements.size() == count110;
+	for(unsigned i = 0; good && i < elements.size(); ++i)
+		good = check110(elements[i], i);
+	env.msg(LVL::verbose, "%u threads, %u steals\n", threads,
+		static_cast<unsigned>(parser.stolen()));
+	env.out(true, "%u elements, %u failed\n",
+		static_cast<unsigned>(elements.size()),
+		static_cast<unsigned>(parser.failed()));
+	return combine1(r && good && parser.failed() == 0);
+}
+
+/* structurally broken arrays are rejected, malformed elements counted */
+static result_t malformed110(const Environment& env) noexcept {
+	static const char_t* const broken[] = {
+		"", "{}", "[", "[1,]", "[,1]", "[{}]]", "[{\"id\":1}] x", "[\"]",
+		"[{\"id\":1},{\"label\":\"x]\"]",
+	};
+	parallel::array<Element110> parser(Element110::structure(), 2, 1);
+	std::vector<Element110> elements;
+	bool r = true;
+	for(auto text : broken)
+		r = r && ! parser.read(text, strlen(text), elements) &&
+			parser.failed() == 0;
+	const char_t* empty = " [ ] ";
+	r = r && parser.read(empty, strlen(empty), elements) && elements.empty();
+	const char_t* mixed =
+		"[{\"id\":1},[2],{\"id\":3},{\"id\":4} 5,\"six\",{\"id\":7}]";
+	bool m = parser.read(mixed, strlen(mixed), elements);
+	env.out(true, "%u elements, %u failed\n",
+		static_cast<unsigned>(elements.size()),
+		static_cast<unsigned>(parser.failed()));
+	return combine1(r && ! m && elements.size() == 6 && parser.failed() == 3 &&
+		elements[0].id == 1 && elements[2].id == 3 && elements[5].id == 7);
+}
+
+/* reports scaling from one to N threads */
+static result_t scaling110(const Environment& env) noexcept {
+	const std::string& text = text110();
+	unsigned max = std::thread::hardware_concurrency();
+	if( max < 4 ) max = 4;
+	bool r = true;
+	for(unsigned threads = 1; threads <= max; threads *= 2) {
+		std::vector<Element110> elements;
+		parallel::array<Element110> parser(Element110::structure(), threads);
+		env.startclock();
+		r = parser.read(text.data(), text.size(), elements) && r;
+		long us = env.elapsed();
+		env.msg(LVL::verbose, "%2u threads: %6ld us, %ld MB/s, %u steals\n",
+			threads, us, us ? static_cast<long>(text.size() / us) : 0L,
+			static_cast<unsigned>(parser.stolen()));
+		r = r && elements.size() == count110;
+	}
+	env.out(true, "%u\n", count110);
+	return combine1(r);
+}
+
+/* one of three threads starts, slices of the others are stolen */
+static result_t starved110(const Environment& env) noexcept {
+	std::string text = "[";
+	char item[32];
+	for(unsigned i = 0; i < 300; ++i) {
+		snprintf(item, sizeof(item), "%s{\"id\":%u}", i ? "," : "", i);
+		text += item;
+	}
+	text += "]";
+	std::vector<Element110> elements;
+	elements.reserve(300);
+	parallel::array<Element110> parser(Element110::structure(), 4, 8);
+	bool r;
+	{
+		test::starve limit(1);
+		r = limit.good() && parser.read(text.data(), text.size(), elements);
+	}
+	for(unsigned i = 0; r && i < elements.size(); ++i)
+		r = elements[i].id == i;
+	env.out(true, "%u elements\n", static_cast<unsigned>(elements.size()));
+	return combine1(r && elements.size() == 300);
+}
+
+struct Named110 {
+	struct Name {
+		NAME(id)
+		NAME(name)
+	};
+	long id;
+	view name;
+	static const clas<Named110>& structure() noexcept {
+		return O<Named110,
+			P<Named110, Name::id, long, &Named110::id>,
+			P<Named110, Name::name, view, &Named110::name>
+		>();
+	}
+};
+
+/* text in a read only mapping is never written, views are not bound */
+static result_t readonly110(const Environment& env) noexcept {
+	static const char_t array[] = "[{\"id\":1,\"name\":\"a\\nb\"},{\"id\":2}]";
+	static const char_t lines[] = "{\"id\":1,\"name\":\"a\\nb\"}\n{\"id\":2}\n";
+	const std::size_t size = 4096;
+	void* page = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if( page == MAP_FAILED ) return bad;
+	char_t* text = static_cast<char_t*>(page);
+	memcpy(text, array, sizeof(array));
+	memcpy(text + sizeof(array), lines, sizeof(lines));
+	bool r = mprotect(page, size, PROT_READ) == 0;
+	std::vector<Named110> elements;
+	std::vector<Named110> records;
+	parallel::array<Named110> parser(Named110::structure(), 2, 1);
+	parallel::ndjson<Named110> reader(Named110::structure(), 2, 1);
+	r = r && ! parser.read(text, sizeof(array) - 1, elements) &&
+		parser.failed() == 1 && elements.size() == 2 && elements[1].id == 2;
+	r = r && ! reader.read(text + sizeof(array), sizeof(lines) - 1, records) &&
+		reader.failed() == 1 && records.size() == 1 && records[0].id == 2;
+	r = r && memcmp(text, array, sizeof(array)) == 0 &&
+		memcmp(text + sizeof(array), lines, sizeof(lines)) == 0;
+	munmap(page, size);
+	env.out(true, "%u elements, %u records\n",
+		static_cast<unsigned>(elements.size()),
+		static_cast<unsigned>(records.size()));
+	return combine1(r);
+}
+
+struct Test110 : Test {
+	static Test110 tests[];
+	inline Test110(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test110(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test110 Test110::tests[] = {
+	RUN("parallel array: single thread", {
+		return run110(env, 1, 32);											}),
+	RUN("parallel array: four threads, uneven elements", {
+		return run110(env, 4, 16);											}),
+	RUN("parallel array: one element per batch", {
+		return run110(env, 3, 1);											}),
+	RUN("parallel array: malformed text and elements", {
+		return malformed110(env);											}),
+	RUN("parallel array: threads fail to start", {
+		return starved110(env);												}),
+	RUN("parallel array: read only text", {
+		return readonly110(env);											}),
+	RUN("parallel array: scaling from one to N threads", {
+		return scaling110(env);												}),
+};
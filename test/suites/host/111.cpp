@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 111.cpp - cojson tests, parallel serialization of large vectors
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "cojson_parallel.hpp"
+#include "cojson_stdlib.hpp"
+#include "starve.hpp"
+#include "test.hpp"
+
+struct Item111 {
+	struct Name {
+		NAME(id)
+		NAME(label)
+		NAME(level)
+		NAME(values)
+	};
+	long id;
+	char label[24];
+	double level;
+	short values[4];
+	static const clas<Item111>& structure() noexcept {
+		return O<Item111,
+			P<Item111, Name::id, long, &Item111::id>,
+			P<Item111, Name::label, sizeof(Item111::label), &Item111::label>,
+			P<Item111, Name::level, double, &Item111::level>,
+			P<Item111, Name::values, short, countof(&Item111::values),
+				&Item111::values>
+		>();
+	}
+};
+
+/* sequential reference, the vector written via PropertyStdVector */
+struct Export111 {
+	struct Name {
+		NAME(items)
+	};
+	std::vector<Item111> items;
+	static const clas<Export111>& structure() noexcept {
+		return O<Export111,
+			P<Export111, Name::items, std::vector<Item111>, &Export111::items,
+				&Item111::structure>
+		>();
+	}
+};
+
+static constexpr unsigned count111 = 20000;
+
+static Export111& export111() noexcept {
+	static Export111 data;
+	if( ! data.items.empty() ) return data;
+	data.items.resize(count111);
+	for(unsigned i = 0; i < count111; ++i) {
+		Item111& item = data.items[i];
+		item.id = i;
+		snprintf(item.label, sizeof(item.label), "item \"%u\"\t", i);
+		item.level = i * 0.25;
+		for(unsigned j = 0; j < countof(&Item111::values); ++j)
+			item.values[j] = static_cast<short>(i * (j + 1));
+	}
+	return data;
+}
+
+/* writes the vector sequentially, returns the array part of the output */
+static std::string sequential111(const std::vector<Item111>& items) noexcept {
+	static const char prefix[] = "{\"items\":";
+	Export111 data;
+	data.items = items;
+	parallel::block out;
+	Export111::structure().write(data, out);
+	if( out.size() < sizeof(prefix) ) return std::string();
+	return std::string(out.data() + sizeof(prefix) - 1,
+		out.size() - sizeof(prefix));
+}
+
+/* parallel output matches the sequential one byte for byte */
+static result_t match111(const Environment& env, unsigned threads,
+		unsigned size) noexcept {
+	std::vector<Item111> items(export111().items.begin(),
+		export111().items.begin() + size);
+	parallel::block out;
+	parallel::writer<Item111> writer(Item111::structure(), threads);
+	bool r = writer.write(items, out);
+	std::string expected = sequential111(items);
+	std::string actual(out.data(), out.size());
+	env.out(true, "%.60s\n", actual.c_str());
+	if( actual != expected )
+		env.msg(LVL::normal, "got %.80s\nexp %.80s\n",
+			actual.c_str(), expected.c_str());
+	return combine1(r && actual == expected);
+}
+
+/* writes to a file via writev, reads back */
+static result_t descriptor111(const Environment& env) noexcept {
+	char name[] = "/tmp/cojson111XXXXXX";
+	int fd = mkstemp(name);
+	if( fd < 0 ) return bad;
+	unlink(name);
+	const std::vector<Item111>& items = export111().items;
+	parallel::writer<Item111> writer(Item111::structure(), 4);
+	parallel::descriptor sink(fd);
+	bool r = writer.write(items, sink);
+	std::string expected = sequential111(items);
+	std::string actual(expected.size() + 1, ' ');
+	ssize_t n = pread(fd, &actual[0], actual.size(), 0);
+	close(fd);
+	actual.resize(n > 0 ? n : 0);
+	env.out(true, "%u bytes\n", static_cast<unsigned>(actual.size()));
+	return combine1(r && sink.error() == 0 && actual == expected);
+}
+
+/* reports parallel writer performance against the sequential writer */
+static result_t benchmark111(const Environment& env) noexcept {
+	Export111& data = export111();
+	parallel::block out;
+	env.startclock();
+	bool r = Export111::structure().write(data, out);
+	long us = env.elapsed();
+	env.msg(LVL::verbose, "sequential: %6ld us, %ld MB/s\n", us,
+		us ? static_cast<long>(out.size() / us) : 0L);
+	unsigned max = std::thread::hardware_concurrency();
+	if( max < 4 ) max = 4;
+	for(unsigned threads = 1; threads <= max; threads *= 2) {
+		parallel::writer<Item111> writer(Item111::structure(), threads);
+		out.clear();
+		env.startclock();
+		r = writer.write(data.items, out) && r;
+		us = env.elapsed();
+		env.msg(LVL::verbose, "%2u threads: %6ld us, %ld MB/s\n", threads, us,
+			us ? static_cast<long>(out.size() / us) : 0L);
+	}
+	env.out(true, "%u\n", count111);
+	return combine1(r);
+}
+
+/* one of three threads starts, the caller writes the other ranges */
+static result_t starved111(const Environment& env) noexcept {
+	std::vector<Item111> items(export111().items.begin(),
+		export111().items.begin() + 300);
+	std::string expected = sequential111(items);
+	parallel::block out;
+	out.write(expected.data(), expected.size());
+	out.clear();
+	parallel::writer<Item111> writer(Item111::structure(), 4);
+	bool r;
+	{
+		test::starve limit(1);
+		r = limit.good() && writer.write(items, out);
+	}
+	std::string actual(out.data(), out.size());
+	env.out(true, "%.60s\n", actual.c_str());
+	return combine1(r && actual == expected);
+}
+
+struct Test111 : Test {
+	static Test111 tests[];
+	inline Test111(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test111(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test111 Test111::tests[] = {
+	RUN("parallel writer: empty vector", {
+		return match111(env, 4, 0);											}),
+	RUN("parallel writer: fewer elements than threads", {
+		return match111(env, 8, 3);											}),
+	RUN("parallel writer: single thread", {
+		return match111(env, 1, count111);									}),
+	RUN("parallel writer: four threads", {
+		return match111(env, 4, count111);									}),
+	RUN("parallel writer: writev to a file", {
+		return descriptor111(env);											}),
+	RUN("parallel writer: threads fail to start", {
+		return starved111(env);												}),
+	RUN("parallel writer: benchmark against sequential writer", {
+		return benchmark111(env);											}),
+};
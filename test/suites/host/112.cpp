@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 112.cpp - cojson tests, structural index of contiguous text
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "cojson_structural.hpp"
+#include "test.hpp"
+
+/* character by character reference: positions and matches */
+static bool reference112(const std::string& text,
+		std::vector<std::size_t>& pos, std::vector<std::size_t>& match) noexcept {
+	std::vector<std::size_t> stack;
+	std::size_t quote = 0;
+	bool instring = false;
+	for(std::size_t i = 0; i < text.size(); ++i) {
+		char c = text[i];
+		if( instring ) {
+			if( c == '\\' ) ++i;
+			else if( c == '"' ) {
+				instring = false;
+				match[quote] = pos.size();
+				match.push_back(quote);
+				pos.push_back(i);
+			}
+			continue;
+		}
+		switch( c ) {
+		case '"':
+			instring = true;
+			quote = pos.size();
+			match.push_back(0);
+			pos.push_back(i);
+			break;
+		case '[': case '{':
+			stack.push_back(pos.size());
+			match.push_back(0);
+			pos.push_back(i);
+			break;
+		case ']': case '}':
+			if( stack.empty() ) return false;
+			match[stack.back()] = pos.size();
+			match.push_back(stack.back());
+			pos.push_back(i);
+			stack.pop_back();
+			break;
+		}
+	}
+	return ! instring && stack.empty();
+}
+
+/* generates nested text with strings full of escapes and brackets */
+static void generate112(std::string& text, unsigned& seed, int depth) noexcept {
+	static const char* const pieces[] = {
+		"a", "\\\\", "\\\"", "[", "{", "}", "]", "\\\\\\\"", "\\\\\\\\", " ",
+		"\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80",
+	};
+	seed = seed * 1103515245 + 12345;
+	unsigned n = 1 + (seed >> 16) % 6;
+	bool object = (seed >> 8) & 1;
+	text += object ? "{" : "[";
+	for(unsigned i = 0; i < n; ++i) {
+		if( i ) text += ",";
+		if( object ) text += "\"k\\\"\":";
+		seed = seed * 1103515245 + 12345;
+		if( depth > 0 && (seed >> 16) % 3 == 0 ) {
+			generate112(text, seed, depth - 1);
+			continue;
+		}
+		text += "\"";
+		unsigned len = (seed >> 20) % 80;
+		for(unsigned j = 0; j < len; ++j) {
+			seed = seed * 1103515245 + 12345;
+			text += pieces[(seed >> 16) % countof(pieces)];
+		}
+		text += "\"";
+	}
+	text += object ? "}" : "]";
+}
+
+/* index matches the reference on generated texts */
+static result_t generated112(const Environment& env) noexcept {
+	unsigned seed = 112;
+	bool r = true;
+	std::size_t entries = 0;
+	structural::index idx;
+	for(unsigned k = 0; k < 200 && r; ++k) {
+		std::string text(k % 67, ' ');
+		generate112(text, seed, 4);
+		std::vector<std::size_t> pos, match;
+		r = reference112(text, pos, match) && idx.build(text.data(), text.size())
+			&& idx.size() == pos.size();
+		for(std::size_t i = 0; r && i < pos.size(); ++i)
+			r = idx.position(i) == pos[i] && idx.match(i) == match[i];
+		if( ! r )
+			env.msg(LVL::normal, "text %u failed at %u: %s\n", k,
+				static_cast<unsigned>(idx.offset()), text.c_str());
+		entries += pos.size();
+	}
+	env.out(true, "%u entries\n", static_cast<unsigned>(entries));
+	return combine1(r);
+}
+
+/* malformed texts are rejected with the failure offset */
+static result_t malformed112(const Environment& env) noexcept {
+	static const struct {
+		const char* text;
+		std::size_t offset;
+	} cases[] = {
+		{ "[1,2}", 4 },
+		{ "{\"a\":[1]]", 8 },
+		{ "[[\"]\"]", 0 },
+		{ "[\"abc\\\"]", 1 },
+		{ "] ", 0 },
+		{ "[\"\xC0\xAF\"]", 2 },			/* overlong			*/
+		{ "[\"\xE0\x9F\xBF\"]", 3 },		/* overlong			*/
+		{ "[\"\xED\xA0\x80\"]", 3 },		/* surrogate		*/
+		{ "[\"\xF4\x90\x80\x80\"]", 3 },	/* above U+10FFFF	*/
+		{ "[\"\xE2\x82\"]", 4 },			/* truncated		*/
+		{ "[\"\x80\"]", 2 },				/* stray continuation */
+		{ "[\"\xE2\x82", 4 },				/* truncated at the end */
+	};
+	structural::index idx;
+	bool r = true;
+	for(const auto& c : cases) {
+		bool b = idx.build(c.text, strlen(c.text));
+		env.out(true, "%u:%X ", static_cast<unsigned>(idx.offset()),
+			+idx.error());
+		if( b || idx.offset() != c.offset )
+			env.msg(LVL::normal, "'%s' offset %u\n", c.text,
+				static_cast<unsigned>(idx.offset()));
+		r = r && ! b && idx.offset() == c.offset &&
+			idx.error() == details::error_t::bad;
+	}
+	env.out(true, "\n");
+	return combine1(r);
+}
+
+struct Item112 {
+	struct Name {
+		NAME(id)
+		NAME(label)
+		NAME(values)
+	};
+	long id;
+	char label[16];
+	short values[3];
+	static const clas<Item112>& structure() noexcept {
+		return O<Item112,
+			P<Item112, Name::id, long, &Item112::id>,
+			P<Item112, Name::label, sizeof(Item112::label), &Item112::label>,
+			P<Item112, Name::values, short, countof(&Item112::values),
+				&Item112::values>
+		>();
+	}
+};
+
+/* generates an item with large unknown members and extra values */
+static std::string item112(unsigned payload) noexcept {
+	std::string text = "{\"extra\":{\"a\":[";
+	for(unsigned i = 0; i < payload; ++i)
+		text += i ? ",{\"s\":\"}]\\\"\",\"n\":[1,2,3]}" : "{}";
+	text += "]},\"label\":\"label\","
+		"\"more\":\"[{\",\"values\":[1,2,3,[4],{\"5\":5},6],\"id\":112}";
+	return text;
+}
+
+/* indexed stream binds the same as a plain buffer and jumps over skipped */
+static result_t binding112(const Environment& env, unsigned payload) noexcept {
+	std::string text = item112(payload);
+	Item112 plain {}, indexed {};
+	buffer in(const_cast<char_t*>(text.data()), text.size());
+	lexer plex(in);
+	bool p = Item112::structure().read(plain, plex);
+	structural::index idx;
+	bool b = idx.build(text.data(), text.size());
+	structural::stream is(idx, text.data(), text.size());
+	lexer lex(is);
+	bool r = Item112::structure().read(indexed, lex);
+	env.out(true, "%d %d %ld %s %d,%d,%d\n", p, r, indexed.id, indexed.label,
+		indexed.values[0], indexed.values[1], indexed.values[2]);
+	return combine1(b && p == r && r && memcmp(&plain, &indexed,
+		sizeof(plain)) == 0 && indexed.id == 112 && indexed.values[2] == 3 &&
+		strcmp(indexed.label, "label") == 0 && is.position() == text.size());
+}
+
+/* reports stage 1 throughput and stage 2 against a plain buffer */
+static result_t benchmark112(const Environment& env) noexcept {
+	std::string text = item112(50000);
+	structural::index idx;
+	bool r = true;
+	env.startclock();
+	for(unsigned i = 0; i < 10; ++i)
+		r = idx.build(text.data(), text.size()) && r;
+	long us = env.elapsed() / 10;
+	env.msg(LVL::verbose, "stage 1: %6ld us, %ld MB/s, %u entries\n", us,
+		us ? static_cast<long>(text.size() / us) : 0L,
+		static_cast<unsigned>(idx.size()));
+	Item112 item {};
+	structural::stream is(idx, text.data(), text.size());
+	lexer lex(is);
+	env.startclock();
+	r = Item112::structure().read(item, lex) && r;
+	us = env.elapsed();
+	env.msg(LVL::verbose, "stage 2: %6ld us\n", us);
+	buffer in(const_cast<char_t*>(text.data()), text.size());
+	lexer plex(in);
+	item = Item112 {};
+	env.startclock();
+	r = Item112::structure().read(item, plex) && r;
+	us = env.elapsed();
+	env.msg(LVL::verbose, "plain  : %6ld us, %ld MB/s\n", us,
+		us ? static_cast<long>(text.size() / us) : 0L);
+	env.out(true, "%ld\n", item.id);
+	return combine1(r && item.id == 112);
+}
+
+struct Test112 : Test {
+	static Test112 tests[];
+	inline Test112(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test112(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test112 Test112::tests[] = {
+	RUN("structural index: generated texts against reference", {
+		return generated112(env);											}),
+	RUN("structural index: malformed structure and UTF-8", {
+		return malformed112(env);											}),
+	RUN("structural index: binding with skipped members", {
+		return binding112(env, 3);											}),
+	RUN("structural index: binding across many blocks", {
+		return binding112(env, 1000);										}),
+	RUN("structural index: benchmark", {
+		return benchmark112(env);											}),
+};
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 113.cpp - cojson tests, skipping deep and large unknown values
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include <string>
+#include "test.hpp"
+
+struct Item113 {
+	struct Name {
+		NAME(id)
+		NAME(values)
+	};
+	long id;
+	short values[2];
+	static const clas<Item113>& structure() noexcept {
+		return O<Item113,
+			P<Item113, Name::id, long, &Item113::id>,
+			P<Item113, Name::values, short, countof(&Item113::values),
+				&Item113::values>
+		>();
+	}
+};
+
+/* memory input stream with windows of limited size, or none at all */
+class stream113 : public details::istream {
+public:
+	stream113(const std::string& text, cojson::size_t window) noexcept
+	  : text(text), pos(0), limit(window) {}
+	bool get(char_t& c) noexcept {
+		if( pos < text.size() ) {
+			c = text[pos++];
+			return true;
+		}
+		c = iostate::eos_c;
+		istream::error(details::error_t::eof);
+		return false;
+	}
+	const char_t* window(cojson::size_t& n) noexcept {
+		n = text.size() - pos;
+		if( n > limit ) n = limit;
+		return limit && n ? text.data() + pos : nullptr;
+	}
+	void advance(cojson::size_t n) noexcept {
+		pos += n;
+	}
+private:
+	const std::string& text;
+	std::size_t pos;
+	cojson::size_t limit;
+};
+
+static std::string nested113(unsigned depth) noexcept {
+	std::string text;
+	for(unsigned i = 0; i < depth; ++i)
+		text += i & 1 ? "{\"a\\\"]\":" : "[\"}\\\\\",";
+	text += "1";
+	for(unsigned i = depth; i-- > 0;)
+		text += i & 1 ? "}" : "]";
+	return text;
+}
+
+/* reads text with given window size, returns "error:id,v0,v1" */
+static bool read113(const Environment& env, const std::string& text,
+		cojson::size_t window, const char* expected) noexcept {
+	Item113 item {};
+	stream113 in(text, window);
+	lexer lex(in);
+	bool r = Item113::structure().read(item, lex);
+	char result[64];
+	snprintf(result, sizeof(result), "%d:%X:%ld,%d,%d", r, +lex.error(),
+		item.id, item.values[0], item.values[1]);
+	env.out(true, "%s ", result);
+	if( strcmp(result, expected) != 0 )
+		env.msg(LVL::normal, "window %u: got %s exp %s\n", window, result,
+			expected);
+	return strcmp(result, expected) == 0;
+}
+
+/* the same result with no window, small windows and a single window */
+static result_t match113(const Environment& env, const std::string& text,
+		const char* expected) noexcept {
+	bool r = true;
+	for(cojson::size_t window : { 0u, 1u, 3u, 7u, 64u, 1u << 20 })
+		r = read113(env, text, window, expected) && r;
+	env.out(true, "\n");
+	return combine1(r);
+}
+
+static result_t depth113(const Environment& env, unsigned depth,
+		const char* expected) noexcept {
+	return match113(env, "{\"u\":" + nested113(depth) +
+		",\"id\":113,\"values\":[1," + nested113(depth) + ",2]}", expected);
+}
+
+/* reports skipping speed with and without windows */
+static result_t benchmark113(const Environment& env) noexcept {
+	std::string text = "{\"u\":[";
+	for(unsigned i = 0; i < 20000; ++i)
+		text += i ? ",{\"s\":\"a long string value \\\"quoted\\\" \","
+			"\"n\":[1,2.5,true,null]}" : "{}";
+	text += "],\"id\":113}";
+	bool r = true;
+	for(cojson::size_t window : { 0u, 1u << 20 }) {
+		Item113 item {};
+		stream113 in(text, window);
+		lexer lex(in);
+		env.startclock();
+		r = Item113::structure().read(item, lex) && item.id == 113 && r;
+		long us = env.elapsed();
+		env.msg(LVL::verbose, "%s: %6ld us, %ld MB/s\n",
+			window ? "window" : "get   ", us,
+			us ? static_cast<long>(text.size() / us) : 0L);
+	}
+	env.out(true, "%u\n", static_cast<unsigned>(text.size()));
+	return combine1(r);
+}
+
+struct Test113 : Test {
+	static Test113 tests[];
+	inline Test113(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test113(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test113 Test113::tests[] = {
+	RUN("skip: unknown number as the last member", {
+		return match113(env, "{\"id\":113,\"u\":5}", "1:0:113,0,0");		}),
+	RUN("skip: strings with brackets and escapes", {
+		return match113(env, "{\"u\":[\"]\\\"\",{\"}\":\"\\\\\"}],\"id\":113 ,"
+			"\"w\":\"x\"}", "1:0:113,0,0");									}),
+	RUN("skip: depth 30", {
+		return depth113(env, 30, "1:2:113,1,0");							}),
+	RUN("skip: depth above skip_depth", {
+		return depth113(env, 40, "0:20:0,0,0");								}),
+	RUN("skip: truncated value", {
+		return match113(env, "{\"id\":113,\"u\":[[\"]\"]", "0:20:113,0,0");	}),
+	RUN("skip: benchmark with and without windows", {
+		return benchmark113(env);											}),
+};
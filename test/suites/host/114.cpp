@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 114.cpp - cojson tests, extraction of values by JSON pointers
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include "test.hpp"
+#include "cojson_pointer.hpp"
+
+static const char_t status114[] =
+	"{\"uptime\":1234,\"wan\":{\"proto\":\"dhcp\",\"ipaddr\":[\"10.0.0.1\","
+	"\"10.0.0.2\",\"192.168.1.17\"],\"stats\":{\"rx\":[1,[2,[3,[4]]]],"
+	"\"tx\":{\"a\":{\"b\":{\"c\":\"}]\"}}}}},\"wifinets\":[{\"ssid\":\"home\","
+	"\"networks\":[{\"quality\":-42,\"name\":\"n0\"},{\"quality\":-70}]},"
+	"{\"ssid\":\"guest\"}],\"a/b\":1,\"m~n\":2,\"\":3,\"last\":true}";
+
+/* extracts two values in a single pass */
+static result_t basic114(const Environment& env) noexcept {
+	char_t ip[16] = {};
+	long quality = 0;
+	Pointer pointers[] = {
+		{ "/wan/ipaddr/2", ip },
+		{ "/wifinets/0/networks/0/quality", quality },
+	};
+	buffer in(status114);
+	bool r = Extract(pointers).read(in);
+	env.out(true, "%s %ld\n", ip, quality);
+	return combine1(r && strcmp(ip, "192.168.1.17") == 0 && quality == -42 &&
+		pointers[0].found() && pointers[1].found());
+}
+
+/* input is not read after the last pointer is resolved */
+static result_t early114(const Environment& env) noexcept {
+	static const char_t truncated[] =
+		"{\"wan\":{\"proto\":\"pppoe\",\"mtu\":1492,\"garbage";
+	char_t proto[8] = {};
+	Pointer pointers[] = { { "/wan/proto", proto } };
+	buffer in(truncated);
+	bool r = Extract(pointers).read(in);
+	env.out(true, "%s\n", proto);
+	return combine1(r && strcmp(proto, "pppoe") == 0);
+}
+
+/* escaped names, empty name, root and order of pointers */
+static result_t names114(const Environment& env) noexcept {
+	int slash = 0, tilde = 0, empty = 0;
+	bool last = false;
+	long uptime = 0;
+	Pointer pointers[] = {
+		{ "/last", last }, { "/a~1b", slash }, { "/m~0n", tilde },
+		{ "/", empty }, { "/uptime", uptime },
+	};
+	buffer in(status114);
+	Extract extract(pointers);
+	bool r = extract.read(in);
+	env.out(true, "%d %d %d %d %ld\n", slash, tilde, empty, last, uptime);
+	return combine1(r && slash == 1 && tilde == 2 && empty == 3 && last &&
+		uptime == 1234 && extract.found() == 5);
+}
+
+/* missing paths and invalid pointers */
+static result_t missing114(const Environment& env) noexcept {
+	long value = 0;
+	char_t ssid[8] = {};
+	Pointer pointers[] = {
+		{ "/wifinets/1/ssid", ssid },
+		{ "/wifinets/01/ssid", value },		/* leading zero */
+		{ "/wan/ipaddr/3", value },			/* beyond the end */
+		{ "/uptime/0", value },				/* into a scalar */
+		{ "/wifinets/-", value },
+	};
+	buffer in(status114);
+	Extract extract(pointers);
+	bool r = extract.read(in);
+	Pointer invalid[] = { { "wan", value }, { "/a~2", value } };
+	buffer again(status114);
+	bool i = Extract(invalid).read(again);
+	env.out(true, "%s %u\n", ssid, extract.found());
+	return combine1(! r && ! i && extract.found() == 1 &&
+		strcmp(ssid, "guest") == 0 && ! invalid[0].valid() &&
+		! invalid[1].valid() && value == 0);
+}
+
+/* the whole document bound by the root pointer */
+static result_t root114(const Environment& env) noexcept {
+	static const char_t number[] = " 114 ";
+	long value = 0;
+	Pointer pointers[] = { { "", value } };
+	buffer in(number);
+	bool r = Extract(pointers).read(in);
+	env.out(true, "%ld\n", value);
+	return combine1(r && value == 114);
+}
+
+/* a pointer given twice is rejected when the set is built */
+static result_t duplicate114(const Environment& env) noexcept {
+	long first = 0, second = 0;
+	Pointer pointers[] = {
+		{ "/uptime", first }, { "/wan/proto", first }, { "/uptime", second }
+	};
+	Extract extract(pointers);
+	buffer in(status114);
+	bool r = extract.read(in);
+	/* a pointer leading into a value addressed by another one */
+	Pointer nested[] = { { "/wan/stats/rx", first }, { "/wan", second },
+		{ "/wan/stats/rx", first } };
+	Pointer member[] = { { "/uptime", first }, { "/uptime/", second } };
+	bool n = ! Extract(nested, 2).valid() && ! Extract(nested + 1, 2).valid()
+		&& ! Extract(member).valid();
+	/* the empty name and a name sharing its first characters */
+	Pointer distinct[] = { { "/", first }, { "/a~1b", second } };
+	buffer again(status114);
+	Extract other(distinct);
+	bool d = other.read(again);
+	env.out(true, "%d %d %d %d %d\n", extract.valid(), r, n, other.valid(), d);
+	return combine1(! extract.valid() && ! r && extract.found() == 0 && n &&
+		other.valid() && d && first == 3 && second == 1);
+}
+
+struct Test114 : Test {
+	static Test114 tests[];
+	inline Test114(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test114(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test114 Test114::tests[] = {
+	RUN("extract: two pointers in one pass", {
+		return basic114(env);												}),
+	RUN("extract: stops after the last pointer", {
+		return early114(env);												}),
+	RUN("extract: escaped and empty names", {
+		return names114(env);												}),
+	RUN("extract: missing paths and invalid pointers", {
+		return missing114(env);												}),
+	RUN("extract: root pointer", {
+		return root114(env);												}),
+	RUN("extract: duplicate and nested pointers", {
+		return duplicate114(env);											}),
+};
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 115.cpp - cojson tests, validation without binding
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include <string>
+#include "cojson_validate.hpp"
+#include "test.hpp"
+
+static const char* const texts115[] = {
+	"0", "-0", " -0.5e+10 ", "1E3", "123.456e-7", "true", "false", "null",
+	"\"\"", "[]", "{}", " [ 1 , [ ] , { } ] ",
+	"{\"a\":[1,{\"b\":null}],\"c\":\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\"}",
+	"\"\\ud83d\\ude00\"", "\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\"",
+	"\t\r\n{\"\":\"\"}\n",
+};
+
+/* text, offset of the failure */
+static const struct { const char* text; std::size_t offset; } errors115[] = {
+	{ "", 0 }, { " ", 1 }, { "01", 1 }, { "-", 1 }, { "1.", 2 }, { ".5", 0 },
+	{ "1e", 2 }, { "1e+", 3 }, { "+1", 0 }, { "tru", 3 }, { "nulls", 4 },
+	{ "[1,]", 3 }, { "[1 2]", 3 }, { "{\"a\"}", 4 }, { "{\"a\":1,}", 7 },
+	{ "{1:2}", 1 }, { "[}", 1 }, { "{]", 1 }, { "[1]]", 3 }, { "[1", 2 },
+	{ "\"a", 2 }, { "\"\\x\"", 2 }, { "\"\\u12g4\"", 5 }, { "\"a\tb\"", 2 },
+	{ "\"\\udc00\"", 6 }, { "\"\\ud800x\"", 7 }, { "\"\\ud800\\u0041\"", 12 },
+	{ "\"\xc0\xaf\"", 1 }, { "\"\xe0\x80\xaf\"", 2 }, { "\"\xed\xa0\x80\"", 2 },
+	{ "\"\xf4\x90\x80\x80\"", 2 }, { "\"\xc3\"", 2 }, { "\"\x80\"", 1 },
+	{ "1 2", 2 }, { "[1]x", 3 }, { "{\"a\":1}}", 7 },
+};
+
+/* validates text fed in runs of given size */
+static bool fed115(const char* text, std::size_t run, std::size_t& offset)
+		noexcept {
+	validator<> v;
+	std::size_t size = strlen(text);
+	bool r = true;
+	for(std::size_t i = 0; r && i < size; i += run)
+		r = v.feed(text + i, run < size - i ? run : size - i);
+	r = r && v.finish();
+	offset = r ? v.size() : v.offset();
+	return r;
+}
+
+/* valid documents pass, fed at once and in runs of any size */
+static result_t valid115(const Environment& env) noexcept {
+	bool r = true;
+	for(auto text : texts115) {
+		std::size_t size = strlen(text), offset;
+		for(std::size_t run = 1; run <= size; ++run) {
+			bool ok = fed115(text, run, offset);
+			if( ! ok )
+				env.msg(LVL::verbose, "'%s' run %u failed at %u\n", text,
+					static_cast<unsigned>(run), static_cast<unsigned>(offset));
+			r = r && ok && offset == size;
+		}
+	}
+	env.out(true, "%u\n", static_cast<unsigned>(countof(texts115)));
+	return combine1(r);
+}
+
+/* invalid documents fail at the offending character */
+static result_t invalid115(const Environment& env) noexcept {
+	bool r = true;
+	for(const auto& t : errors115) {
+		std::size_t size = strlen(t.text), offset = 0;
+		for(std::size_t run = 1; run <= size || run == 1; ++run) {
+			bool ok = fed115(t.text, run, offset);
+			if( ok || offset != t.offset )
+				env.msg(LVL::verbose, "'%s' run %u: %d at %u\n", t.text,
+					static_cast<unsigned>(run), ok,
+					static_cast<unsigned>(offset));
+			r = r && ! ok && offset == t.offset;
+		}
+	}
+	env.out(true, "%u\n", static_cast<unsigned>(countof(errors115)));
+	return combine1(r);
+}
+
+/* limits of depth, size, string and number lengths */
+static result_t limited115(const Environment& env) noexcept {
+	limits depth, size, string, number;
+	depth.depth = 3;
+	size.size = 8;
+	string.string = 4;
+	number.number = 5;
+	std::size_t o1 = 0, o2 = 0, o3 = 0, o4 = 0, o5 = 0, o6 = 0, o7 = 0,
+		o8 = 0;
+	bool r =
+		  Validate("[[[1]]]", 7, depth, &o1) &&
+		! Validate("[[[[1]]]]", 9, depth, &o2) &&
+		  Validate("[1,2,33]", 8, size, &o3) &&
+		! Validate("[1,2,333]", 9, size, &o4) &&
+		  Validate("[\"ab\\u00e9\",\"\xc3\xa9\"]", 17, string, &o5) &&
+		! Validate("{\"abcde\":1}", 11, string, &o6) &&
+		  Validate("[-1.25]", 7, number, &o7) &&
+		! Validate("[1.2e+3]", 8, number, &o8);
+	env.out(true, "%u,%u,%u,%u,%u,%u,%u,%u\n", static_cast<unsigned>(o1),
+		static_cast<unsigned>(o2), static_cast<unsigned>(o3),
+		static_cast<unsigned>(o4), static_cast<unsigned>(o5),
+		static_cast<unsigned>(o6), static_cast<unsigned>(o7),
+		static_cast<unsigned>(o8));
+	return combine1(r && o2 == 3 && o4 == 8 && o6 == 6 && o8 == 6);
+}
+
+/* depth above the supported maximum is an overflow */
+static result_t deep115(const Environment& env) noexcept {
+	std::string text(300, '[');
+	text += std::string(300, ']');
+	validator<> v;
+	bool r = ! v.feed(text.data(), text.size()) &&
+		v.error() == details::error_t::overflow && v.offset() == 256;
+	env.out(true, "%u\n", static_cast<unsigned>(v.offset()));
+	r = r && Validate<512>(text.data(), text.size());
+	return combine1(r);
+}
+
+/* streams with and without windows */
+static result_t streams115(const Environment& env) noexcept {
+	static const char_t text[] = "{\"a\":[1,2.5,\"x\"],\"b\":{\"c\":null}}";
+	static const char_t bad[] = "{\"a\":[1,2.5,\"x\"],\"b\":{\"c\":nul}}";
+	std::size_t o1 = 0, o2 = 0, o3 = 0, o4 = 0;
+	buffer b1(text);	/* zero terminated, no window */
+	buffer b2(const_cast<char_t*>(text), strlen(text));
+	buffer b3(bad);
+	buffer b4(const_cast<char_t*>(bad), strlen(bad));
+	bool r = Validate(b1, limits(), &o1) && Validate(b2, limits(), &o2) &&
+		! Validate(b3, limits(), &o3) && ! Validate(b4, limits(), &o4);
+	env.out(true, "%u,%u,%u,%u\n", static_cast<unsigned>(o1),
+		static_cast<unsigned>(o2), static_cast<unsigned>(o3),
+		static_cast<unsigned>(o4));
+	return combine1(r && o1 == o2 && o3 == 29 && o4 == 29);
+}
+
+/* throughput on a few megabytes of mixed text */
+static result_t throughput115(const Environment& env) noexcept {
+	std::string text = "[";
+	while( text.size() < (4 << 20) )
+		text += "{\"id\":12345,\"name\":\"a moderately long name \\u00e9\","
+			"\"tags\":[\"alpha\",\"beta\",\"gamma\"],\"ratio\":-0.125e-3,"
+			"\"ok\":true,\"next\":null,\"nested\":{\"x\":[1,2,3,[4,5]]}},\n";
+	text += "0]";
+	bool r = true;
+	long best = 0;
+	for(int i = 0; i < 5; ++i) {
+		env.startclock();
+		r = Validate(text.data(), text.size()) && r;
+		long us = env.elapsed();
+		if( best == 0 || us < best ) best = us;
+	}
+	env.msg(LVL::verbose, "%u bytes in %ld us, %ld MB/s\n",
+		static_cast<unsigned>(text.size()), best,
+		best ? static_cast<long>(text.size() / best) : 0L);
+	env.out(true, "%d\n", r);
+	return combine1(r);
+}
+
+struct Test115 : Test {
+	static Test115 tests[];
+	inline Test115(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test115(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test115 Test115::tests[] = {
+	RUN("validate: valid documents in runs of any size", {
+		return valid115(env);											}),
+	RUN("validate: invalid documents and failure offsets", {
+		return invalid115(env);											}),
+	RUN("validate: depth, size, string and number limits", {
+		return limited115(env);											}),
+	RUN("validate: depth above the maximum", {
+		return deep115(env);											}),
+	RUN("validate: streams with and without windows", {
+		return streams115(env);											}),
+	RUN("validate: throughput", {
+		return throughput115(env);										}),
+};
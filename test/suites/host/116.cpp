@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 116.cpp - cojson tests, minifying and reformatting JSON text
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include <string>
+#include "cojson_filters.hpp"
+#include "test.hpp"
+
+/* collects output in a string, bulk writes are appended at once */
+class sink116 : public details::ostream {
+public:
+	bool put(char_t c) noexcept {
+		text += c;
+		return true;
+	}
+	bool write(const char_t* s, cojson::size_t n) noexcept {
+		text.append(s, n);
+		++writes;
+		return true;
+	}
+	std::string text;
+	unsigned writes = 0;
+};
+
+static const char_t compact116[] =
+	"{\"a\":[1,-2.5e+3,true,null],\"b\":{},\"c\":[],"
+	"\"d\":\"x \\\" [ , : ] \\\\\",\"e\":[{\"f\":[[]]}]}";
+
+static const char_t pretty116[] =
+	"{\n"
+	"  \"a\": [\n"
+	"    1,\n"
+	"    -2.5e+3,\n"
+	"    true,\n"
+	"    null\n"
+	"  ],\n"
+	"  \"b\": {},\n"
+	"  \"c\": [],\n"
+	"  \"d\": \"x \\\" [ , : ] \\\\\",\n"
+	"  \"e\": [\n"
+	"    {\n"
+	"      \"f\": [\n"
+	"        []\n"
+	"      ]\n"
+	"    }\n"
+	"  ]\n"
+	"}";
+
+/* reformats text fed in runs of given size */
+static bool run116(const char_t* text, std::size_t run, unsigned indent,
+		std::string& out) noexcept {
+	sink116 sink;
+	wrapper::reformat filter(sink, indent);
+	std::size_t size = strlen(text);
+	bool r = true;
+	for(std::size_t i = 0; r && i < size; i += run)
+		r = filter.write(text + i, run < size - i ? run : size - i);
+	out = sink.text;
+	return r && filter.finish();
+}
+
+/* pretty text is minified, in runs of any size */
+static result_t minify116(const Environment& env) noexcept {
+	bool r = true;
+	std::string out;
+	for(std::size_t run = 1; run <= sizeof(pretty116); ++run) {
+		r = run116(pretty116, run, 0, out) && out == compact116 && r;
+		if( out != compact116 )
+			env.msg(LVL::verbose, "run %u: %s\n", static_cast<unsigned>(run),
+				out.c_str());
+	}
+	env.out(true, "%s\n", out.c_str());
+	return combine1(r);
+}
+
+/* compact text is indented, in runs of any size */
+static result_t indent116(const Environment& env) noexcept {
+	bool r = true;
+	std::string out;
+	for(std::size_t run = 1; run <= sizeof(compact116); ++run) {
+		r = run116(compact116, run, 2, out) && out == pretty116 && r;
+		if( out != pretty116 )
+			env.msg(LVL::verbose, "run %u:\n%s\n", static_cast<unsigned>(run),
+				out.c_str());
+	}
+	env.out(true, "%s\n", out.c_str());
+	return combine1(r);
+}
+
+/* streams with and without windows, top level values on separate lines */
+static result_t streams116(const Environment& env) noexcept {
+	static const char_t text[] = " 1 \"a\"\n{ \"b\" : [ ] }\n\n[ true , 2 ] ";
+	static const char_t expected[] = "1\n\"a\"\n{\"b\":[]}\n[true,2]";
+	sink116 s1, s2;
+	buffer b1(text);	/* zero terminated, no window */
+	buffer b2(const_cast<char_t*>(text), strlen(text));
+	bool r = Minify(b1, s1) && Minify(b2, s2);
+	env.out(true, "%s\n", s2.text.c_str());
+	env.msg(LVL::verbose, "%u/%u writes\n", s1.writes, s2.writes);
+	return combine1(r && s1.text == expected && s2.text == expected);
+}
+
+/* unbalanced brackets and unterminated strings fail */
+static result_t malformed116(const Environment& env) noexcept {
+	std::string out;
+	bool r = ! run116("[1,2", 4, 0, out) && ! run116("[1]]", 4, 0, out) &&
+		! run116("\"abc\\\"", 6, 0, out) && ! run116("{\"a\":{}", 3, 2, out);
+	env.out(true, "%d\n", r);
+	return combine1(r);
+}
+
+/* throughput of minifying compact and pretty text compared to memcpy */
+static result_t throughput116(const Environment& env) noexcept {
+	std::string compact = "[", pretty = "[";
+	while( compact.size() < (4 << 20) ) {
+		compact += compact116;
+		compact += ",";
+		pretty += pretty116;
+		pretty += ",\n";
+	}
+	compact += "0]";
+	pretty += "0]";
+	std::string copy(compact.size(), ' ');
+	long best[3] = {};
+	bool r = true;
+	for(int k = 0; k < 5; ++k) {
+		sink116 s1, s2;
+		s1.text.reserve(compact.size());
+		s2.text.reserve(compact.size());
+		env.startclock();
+		memcpy(&copy[0], compact.data(), compact.size());
+		long us0 = env.elapsed();
+		buffer b1(&compact[0], compact.size());
+		env.startclock();
+		r = Minify(b1, s1) && r;
+		long us1 = env.elapsed();
+		buffer b2(&pretty[0], pretty.size());
+		env.startclock();
+		r = Minify(b2, s2) && r;
+		long us2 = env.elapsed();
+		r = r && s1.text == compact && s2.text == compact;
+		long us[3] = { us0, us1, us2 };
+		for(int i = 0; i < 3; ++i)
+			if( best[i] == 0 || us[i] < best[i] ) best[i] = us[i];
+	}
+	env.msg(LVL::verbose, "memcpy  %6ld us\ncompact %6ld us, %ld MB/s\n"
+		"pretty  %6ld us, %ld MB/s\n", best[0], best[1],
+		best[1] ? static_cast<long>(compact.size() / best[1]) : 0L,
+		best[2], best[2] ? static_cast<long>(pretty.size() / best[2]) : 0L);
+	env.out(true, "%d\n", r);
+	return combine1(r);
+}
+
+struct Test116 : Test {
+	static Test116 tests[];
+	inline Test116(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test116(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test116 Test116::tests[] = {
+	RUN("reformat: minifying in runs of any size", {
+		return minify116(env);												}),
+	RUN("reformat: indenting in runs of any size", {
+		return indent116(env);												}),
+	RUN("reformat: streams and top level values", {
+		return streams116(env);												}),
+	RUN("reformat: malformed text", {
+		return malformed116(env);											}),
+	RUN("reformat: throughput", {
+		return throughput116(env);											}),
+};
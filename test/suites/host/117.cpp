@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 117.cpp - cojson tests, tape DOM
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include "cojson_tape.hpp"
+#include "test.hpp"
+
+static const char_t text117[] =
+	"{\"id\":1234567890123,\"name\":\"tab\\t \\\"q\\\"\",\"ratio\":-0.25,"
+	"\"ok\":true,\"off\":false,\"none\":null,\"list\":[1,[],{},[2,[3]]],"
+	"\"user\":{\"id\":42,\"login\":\"root\",\"score\":2.5}}";
+
+struct User117 {
+	struct Name {
+		NAME(id)
+		NAME(login)
+		NAME(score)
+	};
+	long id;
+	char_t login[8];
+	double score;
+	static const clas<User117>& structure() noexcept {
+		return O<User117,
+			P<User117, Name::id, long, &User117::id>,
+			P<User117, Name::login, sizeof(User117::login), &User117::login>,
+			P<User117, Name::score, double, &User117::score>
+		>();
+	}
+};
+
+/* navigation over a parsed document */
+static result_t navigate117(const Environment& env) noexcept {
+	static uint64_t memory[128];
+	tape::arena arena(memory);
+	tape::document doc(arena);
+	buffer in(text117);
+	bool r = doc.read(in);
+	tape::value root = doc.root();
+	typedef tape::value::type_t type_t;
+	r = r && root.type() == type_t::object && root.size() == 8 &&
+		root["id"].integer() == 1234567890123LL &&
+		strcmp(root["name"].string(), "tab\t \"q\"") == 0 &&
+		root["name"].size() == 8 &&
+		root["ratio"].number() == -0.25 &&
+		root["ok"].boolean() && root["off"].type() == type_t::boolean &&
+		! root["off"].boolean() && root["none"].type() == type_t::null &&
+		! root["missing"] && root["list"].size() == 4 &&
+		root["list"][1].type() == type_t::array &&
+		root["list"][1].size() == 0 &&
+		root["list"][2].type() == type_t::object &&
+		root["list"][3][1][0].integer() == 3 &&
+		! root["list"][4] && ! root["id"][0] &&
+		root["user"]["score"].number() == 2.5;
+	long sum = 0;
+	unsigned keys = 0;
+	for(auto i = root.begin(); i != root.end(); ++i)
+		keys += i.key() != nullptr;
+	for(auto i = root["list"][3].begin(); i != root["list"][3].end(); ++i)
+		sum += (*i).integer();
+	env.out(true, "%u entries, %u bytes, %u keys\n",
+		static_cast<unsigned>(doc.size()),
+		static_cast<unsigned>(arena.used()), keys);
+	return combine1(r && keys == 8 && sum == 2);
+}
+
+/* writing back through the regular writers */
+static result_t write117(const Environment& env) noexcept {
+	static uint64_t memory[128];
+	char_t out[sizeof(text117)] = {};
+	tape::arena arena(memory);
+	tape::document doc(arena);
+	buffer in(text117);
+	buffer dst(out);
+	bool r = doc.read(in) && doc.root().write(dst);
+	env.out(true, "%s\n", out);
+	return combine1(r && strcmp(out, text117) == 0);
+}
+
+/* binding a subtree to a class descriptor */
+static result_t bind117(const Environment& env) noexcept {
+	static uint64_t memory[128];
+	tape::arena arena(memory);
+	tape::document doc(arena);
+	buffer in(text117);
+	User117 user = {};
+	bool r = doc.read(in) &&
+		doc.root()["user"].read(user, User117::structure());
+	env.out(true, "%ld %s %g\n", user.id, user.login, user.score);
+	return combine1(r && user.id == 42 && strcmp(user.login, "root") == 0 &&
+		user.score == 2.5);
+}
+
+/* scalar roots, arena reuse and exhaustion, malformed text */
+static result_t limits117(const Environment& env) noexcept {
+	static uint64_t memory[128];
+	static uint64_t small[8];
+	static uint64_t four[4];
+	tape::arena arena(memory), tiny(small), quad(four);
+	tape::document doc(arena), little(tiny), word(quad);
+	buffer b1("  -17 "), b2("\"abc\""), b3(text117), b4("[1,2"),
+		b5("{\"a\" 1}"), b6("[1,]"), b7("\"abcdefghijklmnopqrstuvw\""),
+		b8("\"abcdefghijklmnopqrstuvwxyz0123456789\"");
+	bool r = doc.read(b1) && doc.root().integer() == -17 && doc.size() == 2 &&
+		doc.read(b2) && strcmp(doc.root().string(), "abc") == 0 &&
+		arena.used() == sizeof(uint64_t) + 4;
+	bool exhausted = ! little.read(b3) && ! little.root();
+	/* a string is not truncated to the arena, reading it fails */
+	exhausted = exhausted && word.read(b7) &&
+		strcmp(word.root().string(), "abcdefghijklmnopqrstuvw") == 0 &&
+		! word.read(b8) && ! word.root() &&
+		(b8.error() & details::error_t::overflow) != details::error_t::noerror;
+	bool malformed = ! doc.read(b4) && ! doc.read(b5) && ! doc.read(b6);
+	env.out(true, "%d %d %d\n", r, exhausted, malformed);
+	return combine1(r && exhausted && malformed);
+}
+
+struct Test117 : Test {
+	static Test117 tests[];
+	inline Test117(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test117(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test117 Test117::tests[] = {
+	RUN("tape: navigating a document", {
+		return navigate117(env);											}),
+	RUN("tape: writing a document back", {
+		return write117(env);												}),
+	RUN("tape: binding to a class descriptor", {
+		return bind117(env);												}),
+	RUN("tape: limits and errors", {
+		return limits117(env);												}),
+};
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 118.cpp - cojson tests, in-situ strings
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include <string>
+#include "cojson_insitu.hpp"
+#include "cojson_ndjson.hpp"
+#include "test.hpp"
+
+struct Item118 {
+	struct Name {
+		NAME(id)
+		NAME(name)
+		NAME(note)
+		NAME(tags)
+	};
+	long id;
+	view name;
+	view note;
+	view tags[3];
+	static const clas<Item118>& structure() noexcept {
+		return O<Item118,
+			P<Item118, Name::id, long, &Item118::id>,
+			P<Item118, Name::name, view, &Item118::name>,
+			P<Item118, Name::note, view, &Item118::note>,
+			P<Item118, Name::tags, view, countof(&Item118::tags),
+				&Item118::tags>
+		>();
+	}
+};
+
+static bool read118(Item118& item, details::istream& in) noexcept {
+	lexer lex(in);
+	return Item118::structure().read(item, lex);
+}
+
+static inline bool inside118(const view& v, const char_t* text, std::size_t n)
+		noexcept {
+	return v.data() >= text && v.data() + v.size() < text + n;
+}
+
+/* plain strings point into the input */
+static result_t plain118(const Environment& env) noexcept {
+	char_t text[] =
+		"{\"id\":7,\"name\":\"plain name\",\"note\":null,\"tags\":[\"a\",\"bc\"]}";
+	buffer in(text, sizeof(text) - 1);
+	Item118 item {};
+	bool r = read118(item, in);
+	env.out(true, "%s %u %s %s\n", item.name.c_str(),
+		static_cast<unsigned>(item.name.size()), item.tags[0].c_str(),
+		item.tags[1].c_str());
+	return combine1(r && item.id == 7 && inside118(item.name, text, sizeof(text))
+		&& strcmp(item.name.c_str(), "plain name") == 0 &&
+		item.note.data() == nullptr && item.tags[1].size() == 2 &&
+		inside118(item.tags[1], text, sizeof(text)) &&
+		item.tags[2].data() == nullptr);
+}
+
+/* escaped strings are decoded in place */
+static result_t escaped118(const Environment& env) noexcept {
+	char_t text[] =
+		"{\"name\":\"tab\\there \\\"q\\\" \\u0041\\/end\",\"note\":\"\\\\\","
+		"\"id\":3}";
+	buffer in(text, sizeof(text) - 1);
+	Item118 item {};
+	bool r = read118(item, in);
+	env.out(true, "%s|%s\n", item.name.c_str(), item.note.c_str());
+	return combine1(r && item.id == 3 &&
+		strcmp(item.name.c_str(), "tab\there \"q\" A/end") == 0 &&
+		item.name.size() == 18 && inside118(item.name, text, sizeof(text)) &&
+		strcmp(item.note.c_str(), "\\") == 0 && item.note.size() == 1);
+}
+
+/* long strings need no reservation */
+static result_t long118(const Environment& env) noexcept {
+	std::string text = "{\"note\":\"";
+	for(int i = 0; i < 100; ++i) text += "0123456789\\n";
+	text += "\"}";
+	Item118 item {};
+	buffer in(&text[0], text.size());
+	bool r = read118(item, in);
+	env.out(true, "%u\n", static_cast<unsigned>(item.note.size()));
+	return combine1(r && item.note.size() == 1100 && item.note[10] == '\n' &&
+		item.note[1099] == '\n');
+}
+
+/* writing views back */
+static result_t write118(const Environment& env) noexcept {
+	char_t text[] = "{\"id\":1,\"name\":\"x\\ty\",\"note\":null,\"tags\":[\"\\\"\"]}";
+	char_t out[sizeof(text) + 16] = {};
+	buffer in(text, sizeof(text) - 1);
+	buffer dst(out);
+	Item118 item {};
+	bool r = read118(item, in) &&
+		Item118::structure().write(item, dst);
+	env.out(true, "%s\n", out);
+	return combine1(r && strcmp(out,
+		"{\"id\":1,\"name\":\"x\\ty\",\"note\":null,\"tags\":[\"\\\"\",null,null]}")
+		== 0);
+}
+
+/* streams without windows can't be read in situ */
+static result_t nowindow118(const Environment& env) noexcept {
+	static const char_t text[] = "{\"id\":5,\"name\":\"n\"}";
+	buffer in(text);	/* zero terminated, no window */
+	Item118 item {};
+	bool r = read118(item, in);
+	env.out(true, "%d %02X\n", r, static_cast<unsigned>(in.error()));
+	return combine1(item.name.data() == nullptr &&
+		(in.error() & details::error_t::noobject) != details::error_t::noerror);
+}
+
+/* windows of separate blocks are not a buffer to decode in place */
+static result_t segments118(const Environment& env) noexcept {
+	char_t head[] = "{\"id\":8,\"name\":\"spans two \\t";
+	char_t tail[] = "segments\\n\",\"note\":\"tail only\"}";
+	char_t fence[] = "untouched";
+	const wrapper::segment list[] = {
+		{ head, sizeof(head) - 1 }, { tail, sizeof(tail) - 1 }
+	};
+	wrapper::segments in(list);
+	Item118 item {};
+	bool r = read118(item, in);
+	env.out(true, "%d %02X %ld\n", r, static_cast<unsigned>(in.error()),
+		item.id);
+	return combine1(item.name.data() == nullptr &&
+		item.note.data() == nullptr && item.id == 8 &&
+		(in.error() & details::error_t::noobject) != details::error_t::noerror
+		&& strcmp(fence, "untouched") == 0 &&
+		strcmp(tail, "segments\\n\",\"note\":\"tail only\"}") == 0);
+}
+
+/* records of an NDJSON line are views into the underlying buffer */
+static result_t ndjson118(const Environment& env) noexcept {
+	char_t text[] = "{\"id\":1,\"name\":\"first\\tline\"}\n{\"id\":2}\n";
+	buffer in(text, sizeof(text) - 1);
+	ndjson::line first(in);
+	Item118 item {};
+	bool r = read118(item, first);
+	env.out(true, "%d %s\n", r, item.name.c_str());
+	return combine1(r && item.id == 1 && inside118(item.name, text,
+		sizeof(text)) && strcmp(item.name.c_str(), "first\tline") == 0);
+}
+
+struct Test118 : Test {
+	static Test118 tests[];
+	inline Test118(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test118(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test118 Test118::tests[] = {
+	RUN("in situ: plain strings point into the input", {
+		return plain118(env);												}),
+	RUN("in situ: escaped strings decoded in place", {
+		return escaped118(env);												}),
+	RUN("in situ: long strings", {
+		return long118(env);												}),
+	RUN("in situ: writing views back", {
+		return write118(env);												}),
+	RUN("in situ: streams without windows", {
+		return nowindow118(env);											}),
+	RUN("in situ: strings spanning segments", {
+		return segments118(env);											}),
+	RUN("in situ: strings in NDJSON lines", {
+		return ndjson118(env);												}),
+};
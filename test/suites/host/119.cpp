@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 119.cpp - cojson tests, raw numbers and strings
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include "cojson_raw.hpp"
+#include "test.hpp"
+
+struct Item119 {
+	struct Name {
+		NAME(id)
+		NAME(price)
+		NAME(ratio)
+		NAME(note)
+	};
+	RawNumber<> id;
+	RawNumber<> price;
+	RawNumber<8> ratio;
+	RawString<24> note;
+	static const clas<Item119>& structure() noexcept {
+		return O<Item119,
+			P<Item119, Name::id, RawNumber<>, &Item119::id>,
+			P<Item119, Name::price, RawNumber<>, &Item119::price>,
+			P<Item119, Name::ratio, RawNumber<8>, &Item119::ratio>,
+			P<Item119, Name::note, RawString<24>, &Item119::note>
+		>();
+	}
+};
+
+static bool read119(Item119& item, details::istream& in) noexcept {
+	lexer lex(in);
+	return Item119::structure().read(item, lex);
+}
+
+/* lexemes are kept as read, converted on access */
+static result_t convert119(const Environment& env) noexcept {
+	buffer in("{\"id\":123456789012345678901234567890,\"price\":1.50e+02,"
+		"\"ratio\":-7,\"note\":\"a\\u0041\\n\\\"\"}");
+	Item119 item {};
+	char_t note[8] = {};
+	bool r = read119(item, in) && item.note.decode(note);
+	env.out(true, "%s %s %s %s\n", item.id.lexeme(), item.price.lexeme(),
+		item.ratio.lexeme(), item.note.lexeme());
+	return combine1(r && strcmp(item.id.lexeme(),
+		"123456789012345678901234567890") == 0 &&
+		strcmp(item.price.lexeme(), "1.50e+02") == 0 &&
+		item.price.number() == 150 && item.price.integer() == 150 &&
+		item.price.number() == 150 && item.ratio.integer() == -7 &&
+		item.ratio.number() == -7 && item.id.number() > 1.2e29 &&
+		strcmp(item.note.lexeme(), "\"a\\u0041\\n\\\"\"") == 0 &&
+		strcmp(note, "aA\n\"") == 0);
+}
+
+/* integer and double conversions are cached apart */
+static result_t fraction119(const Environment& env) noexcept {
+	buffer in("{\"price\":3.75,\"ratio\":-2.5}");
+	Item119 item {};
+	bool r = read119(item, in);
+	long long i = item.price.integer();
+	double d = item.price.number();
+	double e = item.ratio.number();
+	long long j = item.ratio.integer();
+	env.out(true, "%lld %g %g %lld\n", i, d, e, j);
+	return combine1(r && i == 3 && d == 3.75 && item.price.integer() == 3 &&
+		item.price.number() == 3.75 && e == -2.5 && j == -2 &&
+		item.ratio.number() == -2.5);
+}
+
+/* writing back re-emits the lexemes byte for byte */
+static result_t write119(const Environment& env) noexcept {
+	static const char_t text[] =
+		"{\"id\":0.10000000000000000555,\"price\":-0E-0,\"ratio\":1e400,"
+		"\"note\":\"\\u00e9\\/\\t\"}";
+	char_t out[sizeof(text)] = {};
+	buffer in(text);
+	buffer dst(out);
+	Item119 item {};
+	bool r = read119(item, in) && Item119::structure().write(item, dst);
+	env.out(true, "%s\n", out);
+	return combine1(r && strcmp(out, text) == 0);
+}
+
+/* nulls, too long lexemes and malformed strings */
+static result_t limits119(const Environment& env) noexcept {
+	buffer b1("{\"id\":null,\"ratio\":123456789,\"note\":null,\"price\":2}");
+	buffer b2("{\"note\":\"0123456789012345678901\\\"\",\"id\":3}");
+	buffer b3("{\"note\":\"unterminated");
+	char_t out[64] = {};
+	buffer dst(out);
+	Item119 item1 {}, item2 {}, item3 {};
+	bool r1 = read119(item1, b1);
+	bool r2 = read119(item2, b2);
+	bool r3 = read119(item3, b3);
+	Item119::structure().write(item1, dst);
+	env.out(true, "%d %02X %d %02X %d %s\n", r1,
+		static_cast<unsigned>(b1.error()), r2,
+		static_cast<unsigned>(b2.error()), r3, out);
+	return combine1(item1.id.empty() && item1.ratio.empty() &&
+		item1.price.integer() == 2 && item1.note.empty() &&
+		(b1.error() & details::error_t::overrun) != details::error_t::noerror &&
+		item2.note.empty() && item2.id.integer() == 3 &&
+		(b2.error() & details::error_t::overrun) != details::error_t::noerror &&
+		! r3 && item3.note.empty() && strcmp(out,
+		"{\"id\":null,\"price\":2,\"ratio\":null,\"note\":null}") == 0);
+}
+
+struct Test119 : Test {
+	static Test119 tests[];
+	inline Test119(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test119(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test119 Test119::tests[] = {
+	RUN("raw: lexemes converted on access", {
+		return convert119(env);												}),
+	RUN("raw: integer and double of a fraction", {
+		return fraction119(env);											}),
+	RUN("raw: writing lexemes back", {
+		return write119(env);												}),
+	RUN("raw: nulls, limits and errors", {
+		return limits119(env);												}),
+};
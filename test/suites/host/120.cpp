@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 120.cpp - cojson tests, raw values and lazy objects
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include "cojson_raw.hpp"
+#include "cojson_insitu.hpp"
+#include "test.hpp"
+
+struct Meta120 {
+	struct Name {
+		NAME(kind)
+		NAME(seq)
+	};
+	char_t kind[8];
+	long seq;
+	static const clas<Meta120>& structure() noexcept {
+		return O<Meta120,
+			P<Meta120, Name::kind, sizeof(Meta120::kind), &Meta120::kind>,
+			P<Meta120, Name::seq, long, &Meta120::seq>
+		>();
+	}
+};
+
+typedef Lazy<Meta120, Meta120::structure, 64> LazyMeta120;
+
+struct Envelope120 {
+	struct Name {
+		NAME(id)
+		NAME(payload)
+		NAME(meta)
+	};
+	long id;
+	RawJson<48> payload;
+	LazyMeta120 meta;
+	static const clas<Envelope120>& structure() noexcept {
+		return O<Envelope120,
+			P<Envelope120, Name::id, long, &Envelope120::id>,
+			P<Envelope120, Name::payload, RawJson<48>, &Envelope120::payload>,
+			P<Envelope120, Name::meta, LazyMeta120, &Envelope120::meta>
+		>();
+	}
+};
+
+static bool read120(Envelope120& item, details::istream& in) noexcept {
+	lexer lex(in);
+	return Envelope120::structure().read(item, lex);
+}
+
+/* sub-documents pass through verbatim */
+static result_t capture120(const Environment& env) noexcept {
+	char_t text[] =
+		"{\"id\":1,\"payload\": {\"a\" : [1, 2.50],\"b\":\"}\\\"]\"} ,"
+		"\"meta\":{ \"seq\":7,\"kind\":\"ev\" }}";
+	char_t out[sizeof(text)] = {};
+	buffer in(text, sizeof(text) - 1);
+	buffer dst(out);
+	Envelope120 item {};
+	bool r = read120(item, in) && Envelope120::structure().write(item, dst);
+	env.out(true, "%s\n", out);
+	return combine1(r && item.id == 1 && strcmp(item.payload.data(),
+		"{\"a\" : [1, 2.50],\"b\":\"}\\\"]\"}") == 0 && strcmp(out,
+		"{\"id\":1,\"payload\":{\"a\" : [1, 2.50],\"b\":\"}\\\"]\"},"
+		"\"meta\":{ \"seq\":7,\"kind\":\"ev\" }}") == 0);
+}
+
+/* lazy objects are bound on access, written with the structure once edited */
+static result_t lazy120(const Environment& env) noexcept {
+	buffer in("{\"meta\":{\"kind\":\"ev\",  \"seq\":7},\"id\":2}");
+	char_t out[64] = {};
+	buffer dst(out);
+	Envelope120 item {};
+	bool r = read120(item, in);
+	bool bound = item.meta.bind() && strcmp(item.meta->kind, "ev") == 0 &&
+		(*item.meta).seq == 7;
+	item.meta.edit().seq = 8;
+	r = r && Envelope120::structure().write(item, dst);
+	env.out(true, "%s\n", out);
+	return combine1(r && bound && strcmp(out,
+		"{\"id\":2,\"payload\":null,\"meta\":{\"kind\":\"ev\",\"seq\":8}}") == 0);
+}
+
+struct Tag120 {
+	struct Name {
+		NAME(name)
+	};
+	view name;
+	static const clas<Tag120>& structure() noexcept {
+		return O<Tag120,
+			P<Tag120, Name::name, view, &Tag120::name>
+		>();
+	}
+};
+
+/* binding leaves the captured text intact, views are not bound from it */
+static result_t intact120(const Environment& env) noexcept {
+	static const char_t json[] = "{\"kind\":\"a\\nb\",\"seq\":1}";
+	static const char_t tag[] = "{\"name\":\"a\\nb\"}";
+	Lazy<Meta120, Meta120::structure, 64> meta;
+	Lazy<Tag120, Tag120::structure, 64> named;
+	buffer in1(json), in2(tag);
+	lexer lex1(in1), lex2(in2);
+	bool r = meta.read(lex1) && named.read(lex2);
+	bool bound = meta.bind() && strcmp(meta->kind, "a\nb") == 0;
+	bool skipped = named.bind() && named->name.data() == nullptr;
+	char_t out1[64] = {}, out2[64] = {};
+	buffer dst1(out1), dst2(out2);
+	r = r && meta.write(dst1) && named.write(dst2);
+	env.out(true, "%s %s\n", out1, out2);
+	return combine1(r && bound && skipped && strcmp(out1, json) == 0 &&
+		strcmp(out2, tag) == 0 && strcmp(named.raw().data(), tag) == 0);
+}
+
+/* scalars, too long values and malformed text */
+static result_t limits120(const Environment& env) noexcept {
+	buffer b1("{\"payload\":-1.5e3,\"meta\":\"x\\\"y\",\"id\":3}");
+	buffer b2("{\"payload\":[\"0123456789\",\"0123456789\",\"0123456789\","
+		"\"0123456789\"],\"id\":4}");
+	buffer b3("{\"payload\":null,\"meta\":[1,2}");
+	Envelope120 item1 {}, item2 {}, item3 {};
+	bool r1 = read120(item1, b1);
+	bool r2 = read120(item2, b2);
+	bool r3 = read120(item3, b3);
+	env.out(true, "%d %s %s %d %02X %d\n", r1, item1.payload.data(),
+		item1.meta.raw().data(), r2, static_cast<unsigned>(b2.error()), r3);
+	return combine1(r1 && item1.id == 3 &&
+		strcmp(item1.payload.data(), "-1.5e3") == 0 &&
+		strcmp(item1.meta.raw().data(), "\"x\\\"y\"") == 0 &&
+		! item1.meta.bind() && item2.payload.empty() && item2.id == 4 &&
+		(b2.error() & details::error_t::overrun) != details::error_t::noerror &&
+		! r3 && strcmp(item3.payload.data(), "null") == 0);
+}
+
+struct Test120 : Test {
+	static Test120 tests[];
+	inline Test120(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test120(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test120 Test120::tests[] = {
+	RUN("raw json: sub-documents pass through verbatim", {
+		return capture120(env);												}),
+	RUN("raw json: lazy objects", {
+		return lazy120(env);												}),
+	RUN("raw json: bound text stays intact", {
+		return intact120(env);												}),
+	RUN("raw json: scalars, limits and errors", {
+		return limits120(env);												}),
+};
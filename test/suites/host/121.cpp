@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 121.cpp - cojson tests, std::pmr strings and vectors
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "cojson_stdlib.hpp"
+#include "test.hpp"
+
+#ifdef WITH_COJSON_PMR
+
+/* counts allocations passed to the global heap */
+struct Counting121 : std::pmr::memory_resource {
+	unsigned long count = 0;
+	void* do_allocate(std::size_t n, std::size_t a) override {
+		++count;
+		return std::pmr::new_delete_resource()->allocate(n, a);
+	}
+	void do_deallocate(void* p, std::size_t n, std::size_t a) override {
+		std::pmr::new_delete_resource()->deallocate(p, n, a);
+	}
+	bool do_is_equal(const memory_resource& that) const noexcept override {
+		return this == &that;
+	}
+};
+
+struct Doc121 {
+	struct Name {
+		NAME(name)
+		NAME(tags)
+		NAME(values)
+	};
+	typedef std::pmr::polymorphic_allocator<char> allocator_type;
+	explicit Doc121(const allocator_type& a) noexcept
+	  : name(a), tags(a), values(a) {}
+	std::pmr::string name;
+	std::pmr::vector<std::pmr::string> tags;
+	std::pmr::vector<long> values;
+	static const clas<Doc121>& structure() noexcept {
+		return O<Doc121,
+			P<Doc121, Name::name, std::pmr::string, &Doc121::name>,
+			V<Doc121, Name::tags, std::pmr::vector<std::pmr::string>,
+				&Doc121::tags>,
+			V<Doc121, Name::values, std::pmr::vector<long>, &Doc121::values>
+		>();
+	}
+};
+
+static bool read121(Doc121& doc, const std::string& text) noexcept {
+	buffer in(const_cast<char_t*>(text.data()), text.size());
+	lexer lex(in);
+	return Doc121::structure().read(doc, lex);
+}
+
+static std::string text121(unsigned n) {
+	std::string text = "{\"name\":\"document with pmr members\",\"tags\":[";
+	char tmp[48];
+	for(unsigned i = 0; i < n; ++i) {
+		snprintf(tmp, sizeof(tmp), "%s\"tag number %u of the document\"",
+			i ? "," : "", i);
+		text += tmp;
+	}
+	text += "],\"values\":[";
+	for(unsigned i = 0; i < n; ++i) {
+		snprintf(tmp, sizeof(tmp), "%s%u", i ? "," : "", i * 7);
+		text += tmp;
+	}
+	return text + "]}";
+}
+
+/* all allocations of a read come from the context */
+static result_t arena121(const Environment& env) noexcept {
+	const std::string text = text121(20);
+	Counting121 heap;
+	pmr::context<16384> ctx(&heap);
+	Doc121 doc(ctx.allocator());
+	char_t out[1024] = {};
+	buffer dst(out);
+	bool r = read121(doc, text);
+	bool w = Doc121::structure().write(doc, dst);
+	env.out(true, "%lu %u %u\n", heap.count,
+		static_cast<unsigned>(doc.tags.size()),
+		static_cast<unsigned>(doc.values.size()));
+	return combine1(r && w && heap.count == 0 && doc.tags.size() == 20 &&
+		doc.values.size() == 20 && doc.values[19] == 133 &&
+		strcmp(doc.tags[19].c_str(), "tag number 19 of the document") == 0 &&
+		doc.tags[19].get_allocator().resource() == ctx.resource() &&
+		text == out);
+}
+
+/* allocation counts and latency versus the global heap */
+static result_t bench121(const Environment& env) noexcept {
+	const std::string text = text121(500);
+	static constexpr unsigned rounds = 100;
+	Counting121 heap, upstream;
+	bool r = true;
+	env.startclock();
+	for(unsigned i = 0; i < rounds; ++i) {
+		Doc121 doc(&heap);
+		r = read121(doc, text) && r;
+	}
+	long t1 = env.elapsed();
+	env.startclock();
+	for(unsigned i = 0; i < rounds; ++i) {
+		pmr::context<4096> ctx(&upstream);
+		Doc121 doc(ctx.allocator());
+		r = read121(doc, text) && r;
+	}
+	long t2 = env.elapsed();
+	env.msg(LVL::verbose, "global heap: %lu allocations/read, %ld us/read\n",
+		heap.count / rounds, t1 / rounds);
+	env.msg(LVL::verbose, "pmr context: %lu allocations/read, %ld us/read\n",
+		upstream.count / rounds, t2 / rounds);
+	env.out(true, "%d\n", r);
+	return combine1(r && upstream.count * 10 < heap.count);
+}
+#else
+static result_t arena121(const Environment& env) noexcept {
+	env.msg(LVL::verbose, "std::pmr is not available\n");
+	return success;
+}
+static result_t bench121(const Environment& env) noexcept {
+	return arena121(env);
+}
+#endif
+
+struct Test121 : Test {
+	static Test121 tests[];
+	inline Test121(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test121(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test121 Test121::tests[] = {
+	RUN("pmr: allocations of a read come from the context", {
+		return arena121(env);												}),
+	RUN("pmr: allocation counts and latency versus global heap", {
+		return bench121(env);												}),
+};
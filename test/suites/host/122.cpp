@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 122.cpp - cojson tests, std::string reader
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "cojson_stdlib.hpp"
+#include "test.hpp"
+
+struct Doc122 {
+	struct Name {
+		NAME(name)
+		NAME(notes)
+	};
+	std::string name;
+	std::vector<std::string> notes;
+	static const clas<Doc122>& structure() noexcept {
+		return O<Doc122,
+			P<Doc122, Name::name, std::string, &Doc122::name>,
+			V<Doc122, Name::notes, std::vector<std::string>, &Doc122::notes>
+		>();
+	}
+};
+
+static bool read122(Doc122& doc, details::istream& in) noexcept {
+	lexer lex(in);
+	return Doc122::structure().read(doc, lex);
+}
+
+/* strings are terminated properly, escapes decoded between runs */
+static result_t content122(const Environment& env) noexcept {
+	char_t text[] = "{\"name\":\"plain run\",\"notes\":[\"\",\"a\\tb\\u0041\","
+		"\"tail\\\\\",null]}";
+	buffer b1(text, sizeof(text) - 1);
+	buffer b2(text);	/* zero terminated, no window */
+	Doc122 d1, d2;
+	bool r = read122(d1, b1) && read122(d2, b2);
+	env.out(true, "%u %s %u\n", static_cast<unsigned>(d1.name.size()),
+		d1.notes[1].c_str(), static_cast<unsigned>(d1.notes.size()));
+	return combine1(r && d1.name == "plain run" && d1.name.size() == 9 &&
+		d1.notes.size() == 4 && d1.notes[0].empty() &&
+		d1.notes[1] == "a\tbA" && d1.notes[2] == "tail\\" &&
+		d1.notes[3].empty() && d2.name == d1.name && d2.notes == d1.notes);
+}
+
+/* capacity is kept across reads */
+static result_t capacity122(const Environment& env) noexcept {
+	std::string dst;
+	dst.reserve(256);
+	const char_t* data = dst.data();
+	std::size_t capacity = dst.capacity();
+	char_t t1[] = "\"a string that does not fit in a small string buffer\"";
+	char_t t2[] = "\"short\"";
+	buffer b1(t1, sizeof(t1) - 1), b2(t2, sizeof(t2) - 1);
+	lexer l1(b1), l2(b2);
+	bool r = details::reader<std::string>::read(dst, l1) &&
+		dst.size() == sizeof(t1) - 3 &&
+		details::reader<std::string>::read(dst, l2) && dst == "short";
+	env.out(true, "%u %u\n", static_cast<unsigned>(capacity),
+		static_cast<unsigned>(dst.capacity()));
+	return combine1(r && dst.capacity() == capacity && dst.data() == data);
+}
+
+/* throughput on a string heavy document */
+static result_t bench122(const Environment& env) noexcept {
+	std::string text = "{\"name\":\"bench\",\"notes\":[";
+	for(unsigned i = 0; i < 2000; ++i) {
+		if( i ) text += ",";
+		text += "\"";
+		for(unsigned j = 0; j < 8; ++j)
+			text += "a reasonably long note, as found in logs ";
+		text += i % 4 ? "\"" : "\\n\"";
+	}
+	text += "]}";
+	static constexpr unsigned rounds = 20;
+	Doc122 doc;
+	bool r = true;
+	env.startclock();
+	for(unsigned i = 0; i < rounds; ++i) {
+		buffer in(&text[0], text.size());
+		r = read122(doc, in) && r;
+	}
+	long us = env.elapsed();
+	env.msg(LVL::verbose, "%ld MB/s\n",
+		us ? static_cast<long>(text.size() * rounds / us) : 0L);
+	env.out(true, "%u\n", static_cast<unsigned>(doc.notes.size()));
+	return combine1(r && doc.notes.size() == 2000 &&
+		doc.notes[0].size() == 8 * 41 + 1 && doc.notes[0].back() == '\n');
+}
+
+struct Test122 : Test {
+	static Test122 tests[];
+	inline Test122(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test122(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test122 Test122::tests[] = {
+	RUN("std::string: termination and escapes", {
+		return content122(env);												}),
+	RUN("std::string: capacity kept across reads", {
+		return capacity122(env);											}),
+	RUN("std::string: string heavy document", {
+		return bench122(env);												}),
+};
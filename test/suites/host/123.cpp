@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 123.cpp - cojson tests, std::vector binding
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "cojson_stdlib.hpp"
+#include "test.hpp"
+
+/* counts allocations made by vectors */
+static unsigned long allocations123 = 0;
+
+template<typename T>
+struct Counting123 : std::allocator<T> {
+	template<typename U> struct rebind { typedef Counting123<U> other; };
+	Counting123() noexcept {}
+	template<typename U>
+	Counting123(const Counting123<U>&) noexcept {}
+	T* allocate(std::size_t n) {
+		++allocations123;
+		return std::allocator<T>::allocate(n);
+	}
+};
+
+struct Point123 {
+	struct Name {
+		NAME(x)
+		NAME(y)
+	};
+	long x;
+	long y;
+	static const clas<Point123>& structure() noexcept {
+		return O<Point123,
+			P<Point123, Name::x, long, &Point123::x>,
+			P<Point123, Name::y, long, &Point123::y>
+		>();
+	}
+};
+
+typedef std::vector<long, Counting123<long>> Longs123;
+typedef std::vector<std::string> Strings123;
+typedef std::vector<Point123, Counting123<Point123>> Points123;
+
+struct Poll123 {
+	struct Name {
+		NAME(values)
+		NAME(labels)
+		NAME(points)
+	};
+	Longs123 values;
+	Strings123 labels;
+	Points123 points;
+	static const clas<Poll123>& structure() noexcept {
+		return O<Poll123,
+			V<Poll123, Name::values, Longs123, &Poll123::values>,
+			V<Poll123, Name::labels, Strings123, &Poll123::labels>,
+			P<Poll123, Name::points, Points123, &Poll123::points,
+				Point123::structure>
+		>();
+	}
+};
+
+/* the same with a size hint given up front */
+struct Hinted123 {
+	struct Name {
+		NAME(values)
+	};
+	Longs123 values;
+	static const clas<Hinted123>& structure() noexcept {
+		return O<Hinted123,
+			V<Hinted123, Name::values, Longs123, &Hinted123::values, 64>
+		>();
+	}
+};
+
+/* learned hints of its own */
+struct Bounded123 {
+	struct Name {
+		NAME(values)
+	};
+	Longs123 values;
+	static const clas<Bounded123>& structure() noexcept {
+		return O<Bounded123,
+			V<Bounded123, Name::values, Longs123, &Bounded123::values>
+		>();
+	}
+};
+
+struct Tag123 {
+	struct Name {
+		NAME(name)
+		NAME(id)
+		NAME(at)
+		NAME(marks)
+	};
+	std::string name;
+	long id;
+	Point123 at;
+	std::vector<long> marks;
+	static const clas<Tag123>& structure() noexcept {
+		return O<Tag123,
+			P<Tag123, Name::name, std::string, &Tag123::name>,
+			P<Tag123, Name::id, long, &Tag123::id>,
+			P<Tag123, Name::at, Point123, &Tag123::at, Point123::structure>,
+			V<Tag123, Name::marks, std::vector<long>, &Tag123::marks>
+		>();
+	}
+};
+
+struct Tags123 {
+	struct Name {
+		NAME(tags)
+	};
+	std::vector<Tag123> tags;
+	static const clas<Tags123>& structure() noexcept {
+		return O<Tags123,
+			P<Tags123, Name::tags, std::vector<Tag123>, &Tags123::tags,
+				Tag123::structure>
+		>();
+	}
+};
+
+template<class C>
+static bool read123(C& obj, const std::string& text) noexcept {
+	buffer in(const_cast<char_t*>(text.data()), text.size());
+	lexer lex(in);
+	return C::structure().read(obj, lex);
+}
+
+static std::string text123(unsigned n) {
+	std::string values, labels, points;
+	for(unsigned i = 0; i < n; ++i) {
+		const char* sep = i ? "," : "";
+		values += sep + std::to_string(i);
+		labels += sep + std::string("\"a label long enough to allocate ") +
+			std::to_string(i) + "\"";
+		points += sep + std::string("{\"x\":") + std::to_string(i) +
+			",\"y\":" + std::to_string(-static_cast<long>(i)) + "}";
+	}
+	return "{\"values\":[" + values + "],\"labels\":[" + labels +
+		"],\"points\":[" + points + "]}";
+}
+
+/* polling the same document does not reallocate */
+static result_t steady123(const Environment& env) noexcept {
+	const std::string text = text123(50);
+	Poll123 poll;
+	bool r = read123(poll, text);
+	const long* values = poll.values.data();
+	const char* label = poll.labels[49].data();
+	unsigned long first = allocations123;
+	for(unsigned i = 0; i < 10; ++i) r = read123(poll, text) && r;
+	unsigned long steady = allocations123 - first;
+	/* a new object gets the capacity learned from previous reads */
+	Poll123 fresh;
+	first = allocations123;
+	r = read123(fresh, text) && r;
+	unsigned long learned = allocations123 - first;
+	env.out(true, "%lu %lu\n", steady, learned);
+	return combine1(r && steady == 0 && learned == 2 &&
+		poll.values.data() == values && poll.labels[49].data() == label &&
+		poll.points.size() == 50 && poll.points[49].y == -49 &&
+		fresh.values == poll.values);
+}
+
+/* shorter lists truncate, bad and missing items are reset */
+static result_t shrink123(const Environment& env) noexcept {
+	Poll123 poll;
+	bool r = read123(poll, text123(20)) && read123(poll, std::string(
+		"{\"values\":[1,\"x\",3],\"labels\":[\"a\",null],"
+		"\"points\":[{\"x\":5},{\"y\":6}]}"));
+	env.out(true, "%u %u %u\n", static_cast<unsigned>(poll.values.size()),
+		static_cast<unsigned>(poll.labels.size()),
+		static_cast<unsigned>(poll.points.size()));
+	return combine1(r && poll.values.size() == 3 && poll.values[1] == 0 &&
+		poll.values[2] == 3 && poll.labels.size() == 2 &&
+		poll.labels[1].empty() && poll.points.size() == 2 &&
+		poll.points[0].x == 5 && poll.points[0].y == 0 &&
+		poll.points[1].x == 0 && poll.points[1].y == 6 &&
+		poll.values.capacity() >= 20);
+}
+
+/* a hint given by the user reserves ahead of the first read */
+static result_t hint123(const Environment& env) noexcept {
+	std::string text = "{\"values\":[0";
+	for(unsigned i = 1; i < 50; ++i) text += "," + std::to_string(i);
+	text += "]}";
+	Hinted123 obj;
+	unsigned long first = allocations123;
+	bool r = read123(obj, text);
+	unsigned long count = allocations123 - first;
+	env.out(true, "%lu %u\n", count,
+		static_cast<unsigned>(obj.values.capacity()));
+	return combine1(r && count == 1 && obj.values.size() == 50 &&
+		obj.values.capacity() == 64);
+}
+
+/* learned hints are capped, decay and never grow a vector with capacity */
+static result_t bounded123(const Environment& env) noexcept {
+	constexpr unsigned most = (64 << 10) / sizeof(long);
+	std::string big = "{\"values\":[0";
+	for(unsigned i = 1; i < 2 * most; ++i) big += ",1";
+	big += "]}";
+	const std::string small = "{\"values\":[1,2]}";
+	Bounded123 huge, capped, kept;
+	bool r = read123(huge, big) && huge.values.size() == 2 * most;
+	r = r && read123(capped, small);
+	unsigned cap = capped.values.capacity();
+	kept.values.reserve(2);
+	r = r && read123(kept, small);
+	unsigned held = kept.values.capacity();
+	for(unsigned i = 0; i < 10; ++i) {
+		Bounded123 other;
+		r = r && read123(other, small);
+	}
+	Bounded123 decayed;
+	r = r && read123(decayed, small);
+	unsigned later = decayed.values.capacity();
+	env.out(true, "%u %u %u\n", cap, held, later);
+	return combine1(r && cap == most && held == 2 && later < most / 10 &&
+		decayed.values.size() == 2);
+}
+
+/* members of reused object items are reset in place, keeping storage */
+static result_t members123(const Environment& env) noexcept {
+	Tags123 list;
+	bool r = read123(list, std::string("{\"tags\":["
+		"{\"name\":\"the first name, long enough to allocate\",\"id\":1,"
+		"\"at\":{\"x\":1,\"y\":2},\"marks\":[1,2,3]},"
+		"{\"name\":\"the second name, long enough to allocate\",\"id\":2}]}"));
+	r = r && list.tags.size() == 2;
+	const char* first = r ? list.tags[0].name.data() : nullptr;
+	const char* second = r ? list.tags[1].name.data() : nullptr;
+	const long* marks = r ? list.tags[0].marks.data() : nullptr;
+	r = r && read123(list, std::string("{\"tags\":["
+		"{\"name\":\"a new first name, long enough as well\",\"marks\":[4]},"
+		"{\"id\":3}]}"));
+	env.out(true, "%s %ld %ld %ld '%s' %ld\n", list.tags[0].name.c_str(),
+		list.tags[0].id, list.tags[0].at.x, list.tags[0].at.y,
+		list.tags[1].name.c_str(), list.tags[1].id);
+	return combine1(r && list.tags.size() == 2 &&
+		list.tags[0].name.data() == first && list.tags[0].id == 0 &&
+		list.tags[0].at.x == 0 && list.tags[0].at.y == 0 &&
+		list.tags[0].marks.size() == 1 && list.tags[0].marks.data() == marks &&
+		list.tags[1].name.empty() && list.tags[1].name.data() == second &&
+		list.tags[1].id == 3);
+}
+
+struct Test123 : Test {
+	static Test123 tests[];
+	inline Test123(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test123(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test123 Test123::tests[] = {
+	RUN("std::vector: steady state polling", {
+		return steady123(env);												}),
+	RUN("std::vector: shrinking lists and bad items", {
+		return shrink123(env);												}),
+	RUN("std::vector: user size hint", {
+		return hint123(env);												}),
+	RUN("std::vector: learned hints are bounded", {
+		return bounded123(env);												}),
+	RUN("std::vector: members of reused items", {
+		return members123(env);												}),
+};
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 124.cpp - cojson tests, interned strings
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "cojson_intern.hpp"
+#include "test.hpp"
+
+typedef intern::pool<64, 2048, 24> Pool124;
+
+static Pool124& pool124() noexcept {
+	static Pool124 pool;
+	return pool;
+}
+
+typedef intern::string<Pool124, pool124> Label124;
+
+struct Station124 {
+	struct Name {
+		NAME(id)
+		NAME(mode)
+		NAME(proto)
+		NAME(encryption)
+	};
+	long id;
+	Label124 mode;
+	Label124 proto;
+	Label124 encryption;
+	static const clas<Station124>& structure() noexcept {
+		return O<Station124,
+			P<Station124, Name::id, long, &Station124::id>,
+			P<Station124, Name::mode, Label124, &Station124::mode>,
+			P<Station124, Name::proto, Label124, &Station124::proto>,
+			P<Station124, Name::encryption, Label124, &Station124::encryption>
+		>();
+	}
+};
+
+static const char_t* const modes124[] = { "Master", "Managed", "Monitor" };
+static const char_t* const protos124[] = { "dhcp", "static" };
+
+static bool station124(Station124& s, unsigned i) noexcept {
+	char_t text[160];
+	snprintf(text, sizeof(text), "{\"id\":%u,\"mode\":\"%s\",\"proto\":\"%s\","
+		"\"encryption\":\"WPA2 PSK \\u0028CCMP)\"}", i, modes124[i % 3],
+		protos124[i % 2]);
+	buffer in(text, strlen(text));
+	lexer lex(in);
+	return Station124::structure().read(s, lex);
+}
+
+/* equal strings share one copy and compare by pointer */
+static result_t share124(const Environment& env) noexcept {
+	static Station124 fleet[300];
+	bool r = true;
+	for(unsigned i = 0; i < countof(fleet); ++i)
+		r = station124(fleet[i], i) && r;
+	Label124 master;
+	master = "Master";
+	cojson::size_t count = pool124().count();
+	cojson::size_t used = pool124().used();
+	char_t out[96] = {};
+	buffer dst(out);
+	r = r && Station124::structure().write(fleet[3], dst);
+	env.out(true, "%u strings, %u bytes, %u bytes/station\n",
+		static_cast<unsigned>(count), static_cast<unsigned>(used),
+		static_cast<unsigned>(sizeof(Station124)));
+	return combine1(r && count == 6 && fleet[0].mode == fleet[3].mode &&
+		fleet[0].mode != fleet[1].mode && fleet[3].mode == master &&
+		fleet[1].encryption.c_str() == fleet[2].encryption.c_str() &&
+		strcmp(fleet[1].encryption.c_str(), "WPA2 PSK (CCMP)") == 0 &&
+		fleet[1].encryption.size() == 15 && strcmp(out, "{\"id\":3,"
+		"\"mode\":\"Master\",\"proto\":\"static\","
+		"\"encryption\":\"WPA2 PSK (CCMP)\"}") == 0);
+}
+
+/* threads interning the same strings get the same pointers */
+static result_t threads124(const Environment& env) noexcept {
+	static intern::pool<1024, 65536, 24> shared;
+	static const char_t* labels[4][500];
+	std::vector<std::thread> pool;
+	for(unsigned t = 0; t < 4; ++t)
+		pool.emplace_back([t]() {
+			char_t text[24];
+			/* each thread walks the labels in its own order */
+			static const unsigned steps[] = { 1, 3, 7, 9 };
+			for(unsigned n = 0; n < countof(labels[t]); ++n) {
+				unsigned i = (n * steps[t] + t * 101) % countof(labels[t]);
+				snprintf(text, sizeof(text), "label %u", i);
+				labels[t][i] = shared.add(text);
+			}
+		});
+	for(auto& thread : pool) thread.join();
+	bool same = true;
+	for(unsigned t = 0; t < 4; ++t)
+		for(unsigned i = 0; i < countof(labels[t]); ++i)
+			same = same && labels[t][i] != nullptr &&
+				labels[t][i] == labels[0][i];
+	env.out(true, "%u strings, %u bytes\n",
+		static_cast<unsigned>(shared.count()),
+		static_cast<unsigned>(shared.used()));
+	return combine1(same && shared.count() == 500 &&
+		strcmp(labels[3][499], "label 499") == 0);
+}
+
+/* long strings and a full pool */
+static result_t limits124(const Environment& env) noexcept {
+	static intern::pool<4, 48, 16> tiny;
+	Station124 s {};
+	buffer b1("{\"mode\":\"a string too long to be interned\",\"id\":5,"
+		"\"proto\":null}");
+	lexer l1(b1);
+	bool r = Station124::structure().read(s, l1);
+	bool full = tiny.add("one") && tiny.add("two") && tiny.add("three") &&
+		tiny.add("four") == nullptr && tiny.add("one") != nullptr;
+	env.out(true, "%d %02X %u\n", r, static_cast<unsigned>(b1.error()),
+		static_cast<unsigned>(tiny.count()));
+	return combine1(r && s.id == 5 && s.mode.c_str() == nullptr &&
+		s.proto.c_str() == nullptr && full && tiny.count() == 3 &&
+		(b1.error() & details::error_t::overrun) != details::error_t::noerror);
+}
+
+struct Test124 : Test {
+	static Test124 tests[];
+	inline Test124(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test124(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test124 Test124::tests[] = {
+	RUN("interned strings: shared copies", {
+		return share124(env);												}),
+	RUN("interned strings: concurrent interning", {
+		return threads124(env);												}),
+	RUN("interned strings: limits", {
+		return limits124(env);												}),
+};
@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 125.cpp - cojson tests, per thread temporaries
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+#include "cojson.hpp"
+#include "test.hpp"
+
+template<cojson::size_t N>
+using scratch125 =
+	details::temporary_s<char_t, N, config::temporary_is::per_thread>;
+template<cojson::size_t N>
+using stack125 =
+	details::temporary_s<char_t, N, config::temporary_is::automatic>;
+
+/* nested temporaries are stacked in the arena and given back */
+static result_t nesting125(const Environment& env) noexcept {
+	bool r;
+	char_t* outer;
+	{
+		scratch125<32> a;
+		outer = a;
+		{
+			scratch125<24> b;
+			scratch125<8> c;
+			char_t* pb = b;
+			char_t* pc = c;
+			r = pb >= outer + 32 && pc >= pb + 24 && pc < outer + 256;
+		}
+		scratch125<24> d;
+		char_t* pd = d;
+		r = r && pd >= outer + 32 && pd < outer + 64;
+	}
+	scratch125<16> e;
+	/* more than the arena holds comes from the heap */
+	scratch125<config::scratch_size> big;
+	char_t* pe = e;
+	char_t* pbig = big;
+	strcpy(pbig, "not in the arena");
+	env.out(true, "%d %d\n", r, pe == outer);
+	return combine1(r && pe == outer &&
+		(pbig < outer || pbig >= outer + config::scratch_size));
+}
+
+/* temporaries of different threads never overlap */
+static result_t stress125(const Environment& env) noexcept {
+	static constexpr unsigned threads = 8;
+	unsigned bad[threads] = {};
+	std::vector<std::thread> pool;
+	for(unsigned t = 0; t < threads; ++t)
+		pool.emplace_back([t, &bad]() {
+			for(unsigned i = 0; i < 20000; ++i) {
+				scratch125<32> name;
+				scratch125<24> number;
+				char_t* n = name;
+				char_t* d = number;
+				snprintf(n, 32, "thread %u name %u", t, i);
+				snprintf(d, 24, "%u.%u", i, t);
+				if( i % 64 == 0 ) std::this_thread::yield();
+				char_t expect[32];
+				snprintf(expect, sizeof(expect), "thread %u name %u", t, i);
+				bad[t] += strcmp(n, expect) != 0;
+				snprintf(expect, sizeof(expect), "%u.%u", i, t);
+				bad[t] += strcmp(d, expect) != 0;
+			}
+		});
+	for(auto& thread : pool) thread.join();
+	unsigned total = 0;
+	for(unsigned t = 0; t < threads; ++t) total += bad[t];
+	env.out(true, "%u\n", total);
+	return combine1(total == 0);
+}
+
+/* reading names into temporaries, per thread versus on stack */
+template<class Temporary>
+static unsigned names125(unsigned rounds) noexcept {
+	static const char_t text[] = "\"a member name of usual length\"";
+	unsigned n = 0;
+	for(unsigned i = 0; i < rounds; ++i) {
+		Temporary tmp;
+		buffer in(text);
+		lexer lex(in);
+		n += details::reader<char_t*>::read(tmp, Temporary::size, lex);
+	}
+	return n;
+}
+
+static result_t throughput125(const Environment& env) noexcept {
+	static constexpr unsigned threads = 4, rounds = 200000;
+	unsigned counts[2][threads] = {};
+	long us[2];
+	for(unsigned k = 0; k < 2; ++k) {
+		std::vector<std::thread> pool;
+		env.startclock();
+		for(unsigned t = 0; t < threads; ++t)
+			pool.emplace_back([k, t, &counts]() {
+				counts[k][t] = k ? names125<scratch125<32>>(rounds)
+					: names125<stack125<32>>(rounds);
+			});
+		for(auto& thread : pool) thread.join();
+		us[k] = env.elapsed();
+	}
+	env.msg(LVL::verbose, "on stack: %ld names/ms, per thread: %ld names/ms\n",
+		us[0] ? threads * rounds * 1000L / us[0] : 0L,
+		us[1] ? threads * rounds * 1000L / us[1] : 0L);
+	bool r = true;
+	for(unsigned t = 0; t < threads; ++t)
+		r = r && counts[0][t] == rounds && counts[1][t] == rounds;
+	env.out(true, "%d\n", r);
+	return combine1(r);
+}
+
+/* a temporary the heap can't give is not good and takes no lease */
+static result_t failure125(const Environment& env) noexcept {
+	char_t* before;
+	{
+		scratch125<8> a;
+		before = a;
+	}
+	/* the address space is limited for the heap to fail surely */
+	rlimit saved;
+	getrlimit(RLIMIT_AS, &saved);
+	rlimit limited = saved;
+	limited.rlim_cur = rlim_t(1) << 31;
+	bool r = setrlimit(RLIMIT_AS, &limited) == 0;
+	{
+		scratch125<0xFFFFFF00u> huge;
+		r = r && ! huge.good();
+	}
+	setrlimit(RLIMIT_AS, &saved);
+	/* given back out of order, the arena is reset by the lease count */
+	auto x = new scratch125<8>;
+	auto y = new scratch125<8>;
+	delete x;
+	delete y;
+	scratch125<8> b;
+	char_t* after = b;
+	env.out(true, "%d %d\n", r, after == before);
+	return combine1(r && b.good() && after == before);
+}
+
+struct Test125 : Test {
+	static Test125 tests[];
+	inline Test125(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test125(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test125 Test125::tests[] = {
+	RUN("per thread temporaries: nesting and exhaustion", {
+		return nesting125(env);												}),
+	RUN("per thread temporaries: allocation failure", {
+		return failure125(env);												}),
+	RUN("per thread temporaries: multi-threaded stress", {
+		return stress125(env);												}),
+	RUN("per thread temporaries: throughput", {
+		return throughput125(env);											}),
+};
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 126.cpp - cojson tests, constant initialized descriptors
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cojson.hpp"
+#include "test.hpp"
+
+struct Item126 {
+	struct Name {
+		NAME(id)
+		NAME(level)
+	};
+	int id;
+	double level;
+	static const clas<Item126>& structure() noexcept {
+		return O<Item126,
+			P<Item126, Name::id, int, &Item126::id>,
+			P<Item126, Name::level, double, &Item126::level>
+		>();
+	}
+};
+
+/* descriptors are literal types, they compile as constexpr variables */
+static constexpr details::property<Item126>::node nodes126[] = {
+	P<Item126, Item126::Name::id, int, &Item126::id>,
+	P<Item126, Item126::Name::level, double, &Item126::level>
+};
+static constexpr details::clas<Item126> cls126(nodes126, 2);
+
+static int id126;
+static char_t text126[16];
+static constexpr details::node members126[] = {
+	M<Item126::Name::id, V<int, &id126>>,
+	M<Item126::Name::level, V<countof(text126), text126>>
+};
+static constexpr details::object obj126(members126, 2);
+
+/* a constexpr class descriptor reads and writes as the generated one */
+static result_t class126(const Environment& env) noexcept {
+	char_t text[] = "{\"level\":2.5,\"id\":-7}";
+	char_t out[64] = {};
+	buffer in(text, sizeof(text) - 1);
+	buffer dst(out);
+	lexer lex(in);
+	Item126 item {};
+	bool r = cls126.read(item, lex) && cls126.write(item, dst);
+	env.out(true, "%s\n", out);
+	return combine1(r && item.id == -7 && item.level == 2.5 &&
+		strcmp(out, "{\"id\":-7,\"level\":2.5}") == 0);
+}
+
+/* so does a constexpr object of values */
+static result_t values126(const Environment& env) noexcept {
+	char_t text[] = "{\"id\":12,\"level\":\"high\"}";
+	char_t out[64] = {};
+	buffer in(text, sizeof(text) - 1);
+	buffer dst(out);
+	lexer lex(in);
+	bool r = obj126.read(lex) && obj126.write(dst);
+	env.out(true, "%s\n", out);
+	return combine1(r && id126 == 12 && strcmp(text126, "high") == 0 &&
+		strcmp(out, "{\"id\":12,\"level\":\"high\"}") == 0);
+}
+
+/* descriptors returned by factories are the same objects on every access */
+static result_t access126(const Environment& env) noexcept {
+	constexpr unsigned loops = 100000;
+	const clas<Item126>* first = &Item126::structure();
+	Item126 item { 3, 0.5 };
+	char_t out[64] = {};
+	bool r = true;
+	env.startclock();
+	for(unsigned i = 0; i < loops && r; ++i) {
+		buffer dst(out);
+		r = &Item126::structure() == first &&
+			Item126::structure().write(item, dst);
+	}
+	long us = env.elapsed();
+	env.out(true, "%d\n", r);
+	env.msg(LVL::verbose, "%u writes in %ld us\n", loops, us);
+	return combine1(r && strcmp(out, "{\"id\":3,\"level\":0.5}") == 0);
+}
+
+struct Test126 : Test {
+	static Test126 tests[];
+	inline Test126(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test126(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test126 Test126::tests[] = {
+	RUN("constant descriptors: constexpr class", {
+		return class126(env);												}),
+	RUN("constant descriptors: constexpr object", {
+		return values126(env);												}),
+	RUN("constant descriptors: repeated access", {
+		return access126(env);												}),
+};
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * 127.cpp - cojson tests, presence of properties
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "cojson_stdlib.hpp"
+#include "test.hpp"
+
+struct Link127 {
+	struct Name {
+		NAME(up)
+		NAME(speed)
+	};
+	bool up;
+	int speed;
+	static const clas<Link127>& structure() noexcept {
+		return O<Link127,
+			P<Link127, Name::up, bool, &Link127::up>,
+			P<Link127, Name::speed, int, &Link127::speed>
+		>();
+	}
+};
+
+/* first member at offset 0 shares the address of its owner */
+struct Node127 {
+	struct Name {
+		NAME(link)
+		NAME(id)
+		NAME(ports)
+		NAME(log)
+	};
+	Link127 link;
+	int id;
+	Link127 ports[4];
+	char_t log[512];
+	static const clas<Node127>& structure() noexcept {
+		return O<Node127,
+			P<Node127, Name::link, Link127, &Node127::link, Link127::structure>,
+			P<Node127, Name::id, int, &Node127::id>,
+			P<Node127, Name::ports, Link127, countof(&Node127::ports),
+				&Node127::ports, Link127::structure>,
+			P<Node127, Name::log, countof(&Node127::log), &Node127::log>
+		>();
+	}
+};
+
+/* items of a vector move while it grows */
+struct Bus127 {
+	struct Name {
+		NAME(links)
+		NAME(id)
+	};
+	std::vector<Link127> links;
+	int id;
+	static const clas<Bus127>& structure() noexcept {
+		return O<Bus127,
+			P<Bus127, Name::links, std::vector<Link127>, &Bus127::links,
+				Link127::structure>,
+			P<Bus127, Name::id, int, &Bus127::id>
+		>();
+	}
+};
+
+/* properties past the first mask word */
+struct Wide127 {
+	struct Name {
+		NAME(p0)
+		NAME(p1)
+		NAME(p2)
+		NAME(p3)
+		NAME(p4)
+		NAME(p5)
+		NAME(p6)
+		NAME(p7)
+		NAME(p8)
+		NAME(p9)
+		NAME(p10)
+		NAME(p11)
+		NAME(p12)
+		NAME(p13)
+		NAME(p14)
+		NAME(p15)
+		NAME(p16)
+		NAME(p17)
+		NAME(p18)
+		NAME(p19)
+		NAME(p20)
+		NAME(p21)
+		NAME(p22)
+		NAME(p23)
+		NAME(p24)
+		NAME(p25)
+		NAME(p26)
+		NAME(p27)
+		NAME(p28)
+		NAME(p29)
+		NAME(p30)
+		NAME(p31)
+		NAME(p32)
+		NAME(p33)
+		NAME(p34)
+		NAME(p35)
+	};
+	int p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17, p18, p19, p20, p21, p22, p23, p24, p25, p26, p27, p28, p29, p30, p31, p32, p33, p34, p35;
+	static const clas<Wide127>& structure() noexcept {
+		return O<Wide127,
+			P<Wide127, Name::p0, int, &Wide127::p0>,
+			P<Wide127, Name::p1, int, &Wide127::p1>,
+			P<Wide127, Name::p2, int, &Wide127::p2>,
+			P<Wide127, Name::p3, int, &Wide127::p3>,
+			P<Wide127, Name::p4, int, &Wide127::p4>,
+			P<Wide127, Name::p5, int, &Wide127::p5>,
+			P<Wide127, Name::p6, int, &Wide127::p6>,
+			P<Wide127, Name::p7, int, &Wide127::p7>,
+			P<Wide127, Name::p8, int, &Wide127::p8>,
+			P<Wide127, Name::p9, int, &Wide127::p9>,
+			P<Wide127, Name::p10, int, &Wide127::p10>,
+			P<Wide127, Name::p11, int, &Wide127::p11>,
+			P<Wide127, Name::p12, int, &Wide127::p12>,
+			P<Wide127, Name::p13, int, &Wide127::p13>,
+			P<Wide127, Name::p14, int, &Wide127::p14>,
+			P<Wide127, Name::p15, int, &Wide127::p15>,
+			P<Wide127, Name::p16, int, &Wide127::p16>,
+			P<Wide127, Name::p17, int, &Wide127::p17>,
+			P<Wide127, Name::p18, int, &Wide127::p18>,
+			P<Wide127, Name::p19, int, &Wide127::p19>,
+			P<Wide127, Name::p20, int, &Wide127::p20>,
+			P<Wide127, Name::p21, int, &Wide127::p21>,
+			P<Wide127, Name::p22, int, &Wide127::p22>,
+			P<Wide127, Name::p23, int, &Wide127::p23>,
+			P<Wide127, Name::p24, int, &Wide127::p24>,
+			P<Wide127, Name::p25, int, &Wide127::p25>,
+			P<Wide127, Name::p26, int, &Wide127::p26>,
+			P<Wide127, Name::p27, int, &Wide127::p27>,
+			P<Wide127, Name::p28, int, &Wide127::p28>,
+			P<Wide127, Name::p29, int, &Wide127::p29>,
+			P<Wide127, Name::p30, int, &Wide127::p30>,
+			P<Wide127, Name::p31, int, &Wide127::p31>,
+			P<Wide127, Name::p32, int, &Wide127::p32>,
+			P<Wide127, Name::p33, int, &Wide127::p33>,
+			P<Wide127, Name::p34, int, &Wide127::p34>,
+			P<Wide127, Name::p35, int, &Wide127::p35>
+		>();
+	}
+};
+
+static bool read127(Node127& node, const char_t* json, details::presence& seen)
+		noexcept {
+	char_t text[256];
+	strcpy(text, json);
+	buffer in(text, strlen(text));
+	lexer lex(in);
+	return Node127::structure().read(node, lex, seen);
+}
+
+/* bits of nested objects and array items are kept apart */
+static result_t nested127(const Environment& env) noexcept {
+	Node127 node {};
+	Presence<8> seen;
+	bool r = read127(node,
+		"{\"id\":1,\"link\":{\"speed\":100},\"ports\":[{\"up\":true},{}]}", seen);
+	env.out(true, "%u %X %X %X %X\n", static_cast<unsigned>(seen.count()),
+		seen.mask(node), seen.mask(node.link), seen.mask(node.ports[0]),
+		seen.mask(node.ports[1]));
+	return combine1(r && seen.mask(node) == 0x7 &&
+		seen.mask(node.link) == 0x2 && seen.has(node.link, 1) &&
+		! seen.has(node.link, 0) && seen.mask(node.ports[0]) == 0x1 &&
+		seen.mask(node.ports[1]) == 0 && seen.mask(node.ports[2]) == 0 &&
+		seen.all(node, 3) && ! seen.all(node, 4));
+}
+
+/* records follow vector items reallocated while reading */
+static result_t vector127(const Environment& env) noexcept {
+	char_t text[] = "{\"links\":[{\"up\":true},{\"speed\":2},{},"
+		"{\"up\":false,\"speed\":4},{\"speed\":5}],\"id\":1}";
+	Bus127 bus {};
+	Presence<8> seen;
+	buffer in(text, sizeof(text) - 1);
+	lexer lex(in);
+	bool r = Bus127::structure().read(bus, lex, seen);
+	const auto& l = bus.links;
+	env.out(true, "%u %u %X %X %X %X %X\n", static_cast<unsigned>(l.size()),
+		static_cast<unsigned>(seen.count()), seen.mask(l[0]), seen.mask(l[1]),
+		seen.mask(l[2]), seen.mask(l[3]), seen.mask(l[4]));
+	return combine1(r && l.size() == 5 && seen.count() == 5 &&
+		seen.mask(bus) == 0x3 && seen.mask(l[0]) == 0x1 &&
+		seen.mask(l[1]) == 0x2 && seen.mask(l[2]) == 0 &&
+		seen.mask(l[3]) == 0x3 && seen.mask(l[4]) == 0x2);
+}
+
+/* polling without clearing, only properties not seen are reset */
+static void reset127(Node127& node, const details::presence& seen) noexcept {
+	if( ! seen.has(node.link, 0) ) node.link.up = false;
+	if( ! seen.has(node.link, 1) ) node.link.speed = 0;
+	if( ! seen.has(node, 1) ) node.id = 0;
+	for(auto& port : node.ports) {
+		if( ! seen.has(port, 0) ) port.up = false;
+		if( ! seen.has(port, 1) ) port.speed = 0;
+	}
+	if( ! seen.has(node, 3) ) node.log[0] = 0;
+}
+
+static result_t poll127(const Environment& env) noexcept {
+	Node127 node {};
+	Presence<8> seen;
+	bool r = read127(node,
+		"{\"id\":5,\"link\":{\"up\":true,\"speed\":10},\"log\":\"boot\","
+		"\"ports\":[{\"up\":true,\"speed\":1},{\"speed\":2}]}", seen);
+	reset127(node, seen);
+	r = r && node.id == 5 && node.ports[1].speed == 2;
+	r = r && read127(node, "{\"link\":{\"speed\":20},\"ports\":[{\"up\":false}]}",
+		seen);
+	reset127(node, seen);
+	env.out(true, "%d %d %d %d %d %d '%s'\n", node.id, node.link.up,
+		node.link.speed, node.ports[0].up, node.ports[0].speed,
+		node.ports[1].speed, node.log);
+	return combine1(r && node.id == 0 && ! node.link.up &&
+		node.link.speed == 20 && ! node.ports[0].up && node.ports[0].speed == 0
+		&& node.ports[1].speed == 0 && node.log[0] == 0);
+}
+
+/* going past the record sets overrun, reading goes on */
+static result_t limits127(const Environment& env) noexcept {
+	Node127 node {};
+	Presence<2> seen;
+	char_t text[] = "{\"link\":{\"up\":true},\"ports\":[{\"up\":true},"
+		"{\"speed\":3}],\"id\":9}";
+	buffer in(text, sizeof(text) - 1);
+	lexer lex(in);
+	bool r = Node127::structure().read(node, lex, seen);
+	env.out(true, "%d %02X %u\n", r, static_cast<unsigned>(lex.error()),
+		static_cast<unsigned>(seen.count()));
+	return combine1(r && lex.error() == details::error_t::overrun &&
+		seen.count() == 2 && node.id == 9 && node.ports[1].speed == 3 &&
+		seen.has(node, 1) && seen.mask(node.ports[1]) == 0 &&
+		lex.tracking() == nullptr);
+}
+
+/* wide classes take more mask words, the record has to have room for them */
+static result_t wide127(const Environment& env) noexcept {
+	char_t text[] = "{\"p1\":1,\"p33\":33,\"p35\":35,\"p0\":0}";
+	Wide127 wide {};
+	Presence<2, 36> seen;
+	Presence<1> narrow;
+	buffer in(text, sizeof(text) - 1);
+	lexer lex(in);
+	bool r = Wide127::structure().read(wide, lex, seen);
+	char_t again[sizeof(text)];
+	memcpy(again, text, sizeof(text));
+	buffer in2(again, sizeof(text) - 1);
+	lexer lex2(in2);
+	bool r2 = Wide127::structure().read(wide, lex2, narrow);
+	env.out(true, "%d %d %X %d %d %d %02X\n", r, r2, seen.mask(wide),
+		seen.has(wide, 33), seen.has(wide, 34), seen.has(wide, 35),
+		static_cast<unsigned>(lex2.error()));
+	return combine1(r && lex.error() == details::error_t::noerror &&
+		wide.p35 == 35 && seen.count() == 1 && seen.mask(wide) == 0x3 &&
+		seen.has(wide, 33) && ! seen.has(wide, 34) && seen.has(wide, 35) &&
+		! seen.has(wide, 36) && seen.all(wide, 2) && ! seen.all(wide, 34) &&
+		r2 && lex2.error() == details::error_t::overrun &&
+		narrow.count() == 0 && ! narrow.has(wide, 1));
+}
+
+/* cost of clearing the whole object vs resetting what was not seen */
+static result_t bench127(const Environment& env) noexcept {
+	constexpr unsigned loops = 20000;
+	static const char_t json[] = "{\"id\":5,\"link\":{\"up\":true,\"speed\":10},"
+		"\"ports\":[{\"up\":true,\"speed\":1},{\"speed\":2}]}";
+	Node127 node {};
+	Presence<8> seen;
+	bool r = true;
+	env.startclock();
+	for(unsigned i = 0; i < loops && r; ++i) {
+		memset(&node, 0, sizeof(node));
+		char_t text[sizeof(json)];
+		memcpy(text, json, sizeof(json));
+		buffer in(text, sizeof(json) - 1);
+		lexer lex(in);
+		r = Node127::structure().read(node, lex);
+	}
+	long cleared = env.elapsed();
+	env.startclock();
+	for(unsigned i = 0; i < loops && r; ++i) {
+		char_t text[sizeof(json)];
+		memcpy(text, json, sizeof(json));
+		buffer in(text, sizeof(json) - 1);
+		lexer lex(in);
+		r = Node127::structure().read(node, lex, seen);
+		reset127(node, seen);
+	}
+	long tracked = env.elapsed();
+	env.out(true, "%d\n", r);
+	env.msg(LVL::verbose, "%u polls: cleared %ld us, tracked %ld us\n",
+		loops, cleared, tracked);
+	return combine1(r && node.ports[1].speed == 2 && node.ports[2].up == false);
+}
+
+struct Test127 : Test {
+	static Test127 tests[];
+	inline Test127(cstring name, cstring desc, runner func)
+		noexcept : Test(name, desc, func) {}
+	int index() const noexcept {
+		return (this-tests);
+	}
+};
+
+#define RUN(name, body) Test127(__FILE__,name, \
+		[](const Environment& env) noexcept -> result_t body)
+Test127 Test127::tests[] = {
+	RUN("presence: nested objects and array items", {
+		return nested127(env);												}),
+	RUN("presence: items of a growing vector", {
+		return vector127(env);												}),
+	RUN("presence: polling without clearing", {
+		return poll127(env);												}),
+	RUN("presence: limits", {
+		return limits127(env);												}),
+	RUN("presence: classes wider than a mask word", {
+		return wide127(env);												}),
+	RUN("presence: cleared vs tracked polls", {
+		return bench127(env);												}),
+};
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2018 Eugene Hutorny <eugene@hutorny.in.ua>
+ *
+ * starve.hpp - cojson tests, address space limit for failing thread starts
+ *
+ * This file is part of COJSON Library. http://hutorny.in.ua/projects/cojson
+ *
+ * The COJSON Library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License v2
+ * as published by the Free Software Foundation;
+ *
+ * The COJSON Library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the COJSON Library; if not, see
+ * <http://www.gnu.org/licenses/gpl-2.0.html>.
+ */
+
+#ifndef STARVE_HPP_
+#define STARVE_HPP_
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <pthread.h>
+
+namespace cojson {
+namespace test {
+
+/**
+ * Limits the address space to what is mapped now plus a megabyte, so
+ * small allocations still succeed, and room for stacks of the given
+ * number of threads, so that no more threads can be started.
+ * Default stacks are made larger than any cached one, so stacks of
+ * threads finished earlier are not reused.
+ * The limit is lifted when the object goes out of scope
+ */
+class starve {
+public:
+	inline starve(unsigned threads) noexcept {
+		unsigned long pages = 0;
+		FILE* f = fopen("/proc/self/statm", "r");
+		if( f ) {
+			if( fscanf(f, "%lu", &pages) != 1 ) pages = 0;
+			fclose(f);
+		}
+		limited = pages != 0 && getrlimit(RLIMIT_AS, &saved) == 0 &&
+			pthread_getattr_default_np(&attr) == 0 &&
+			pthread_attr_getstacksize(&attr, &stack) == 0;
+		if( ! limited ) return;
+		pthread_attr_setstacksize(&attr, huge);
+		pthread_setattr_default_np(&attr);
+		rlimit lim = saved;
+		lim.rlim_cur = pages * sysconf(_SC_PAGESIZE) + (1 << 20) +
+			threads * (huge + (2 << 20));
+		limited = setrlimit(RLIMIT_AS, &lim) == 0;
+	}
+	inline ~starve() noexcept {
+		if( ! limited ) return;
+		setrlimit(RLIMIT_AS, &saved);
+		pthread_attr_setstacksize(&attr, stack);
+		pthread_setattr_default_np(&attr);
+		pthread_attr_destroy(&attr);
+	}
+	/** true if the limit is in effect */
+	inline bool good() const noexcept { return limited; }
+private:
+	static constexpr ::size_t huge = ::size_t(1) << 30;
+	rlimit saved;
+	pthread_attr_t attr;
+	::size_t stack;
+	bool limited;
+};
+
+}
+}
+
+#endif